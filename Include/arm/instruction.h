@@ -5,9 +5,14 @@
 #ifndef ARM_INSTRUCTION_H
 #define ARM_INSTRACTION_H
 
+#include <array>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 
+struct arm_disassembly;
+
 namespace arm {
     // adc, add, and, asr, b, bfc, bfi, bic, bkpt,
     // bl, blx, bx, cbz, cbnz, clz, cmp, cmn, eor, ldm, ldr,
@@ -47,10 +52,52 @@ namespace arm {
     enum class address_increment_order { IA = 0, IB, DA, DB };
     enum class register_data_size { W = 0, B, SB, H, SH, D };
 
+    enum class operand_kind : uint8_t {
+        REGISTER,  // R0-R15 and their aliases
+        MEMORY,    // the base register of an address, "[Rn"
+        SHIFT,     // LSL, LSR, ASR, ROR, RRX; see instruction_t::shift()
+        IMMEDIATE, // #value
+        OTHER      // labels, addresses, anything else
+    };
+
+    enum class shift_t : uint8_t { NONE, LSL, LSR, ASR, ROR, RRX };
+
+    /* a mnemonic split into its parts; variant is the instruction's
+       address_increment_order (LDM, STM) or register_data_size (LDR, STR) */
+    struct mnemonic_t {
+        command_t command;
+        bool set;
+        condition_t condition;
+        uint8_t variant;
+    };
+
     class instruction_t {
     public:
         static instruction_t parse(const std::string& line);
 
+        /* command UNKNOWN if the mnemonic is not one of command_t's */
+        static mnemonic_t classify(std::string_view mnemonic);
+
+        /* builds the instruction from a mnemonic and operand tokens that a
+           disassembler has already split out, skipping the line tokenizer;
+           commas may still be attached to the operands */
+        static instruction_t from_tokens(
+            const std::string& mnemonic,
+            const std::vector<std::string>& operands,
+            std::string_view comments,
+            std::string_view original);
+
+        /* builds the instruction from a decoded record: the command, S flag
+           and condition come from the record and its opcode entry rather
+           than the text, and only the operands are read from the line; a
+           non-empty label stands in for the first operand */
+        static instruction_t from_record(
+            const arm_disassembly& records,
+            size_t index,
+            std::string_view comments,
+            std::string_view original,
+            std::string_view label = {});
+
         inline command_t command() const
         { return m_command; }
 
@@ -69,14 +116,22 @@ namespace arm {
         inline unsigned int order() const
         { return m_order; }
 
-        inline const std::vector<std::string>& parameters() const
-        { return m_params; }
+        inline size_t parameter_count() const
+        { return m_param_count; }
+
+        std::string_view parameter(size_t index) const;
+
+        inline operand_kind parameter_kind(size_t index) const
+        { return m_params[index].kind; }
 
-        inline const std::string& comments() const
-        { return m_comments; }
+        /* NONE unless the operand is of kind SHIFT */
+        shift_t shift(size_t index) const;
 
-        inline const std::string& to_string() const
-        { return m_original; }
+        inline std::string_view comments() const
+        { return std::string_view(m_text).substr(m_original_size, m_comments_size); }
+
+        inline std::string_view to_string() const
+        { return std::string_view(m_text).substr(0, m_original_size); }
 
         std::string tag_string() const;
 
@@ -91,14 +146,36 @@ namespace arm {
             register_data_size m_register_data_size;
         } m_info;
         unsigned int m_order;
-        std::vector<std::string> m_params;
-        std::string m_comments;
-        std::string m_original;
 
-        static command_t command_from_string(const std::string& s, size_t o = 0);
+        /* Register and shift names are interned (name != 0), with an
+           address's brackets stripped; any other operand is the slice
+           m_text[offset, offset + size). All of an instruction's text
+           shares the one buffer.  */
+        struct operand_t {
+            operand_kind kind;
+            uint8_t name;
+            uint16_t offset;
+            uint16_t size;
+        };
+        static constexpr size_t max_params = 18;
+
+        std::string m_text; /* original line, comments, then operands */
+        uint16_t m_original_size;
+        uint16_t m_comments_size;
+        uint8_t m_param_count;
+        std::array<operand_t, max_params> m_params;
+
+        static instruction_t build(
+            const mnemonic_t& parts,
+            const std::string_view* tokens,
+            size_t count,
+            std::string_view comments,
+            std::string_view original,
+            size_t text_size);
+
+        void add_param(std::string_view token, std::string_view strip);
+
         static std::string command_to_string(command_t c);
-        static size_t command_string_size(command_t c);
-        static condition_t condition_from_chars(char a, char b);
         static std::string condition_to_string(condition_t c);
         static std::string string_from_condition(condition_t c);
     };
@@ -0,0 +1,60 @@
+#ifndef DECODE_CACHE_H
+#define DECODE_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "arm_disassembler.h"
+
+#define DECODE_CACHE_ENV "ARM_DECODE_CACHE"
+
+/**
+ * On-disk cache of decoded instruction records, so unchanged code is not
+ * run through libopcodes again. An entry holds the records of a list of
+ * spans, laid out as arm_disassembler::decode(spans, first) returns them,
+ * and is named after a hash of the spans' bytes, addresses and mapping
+ * symbols and the decoder settings; changed code simply misses.
+ *
+ * Entries are flat files read back through a read-only mapping:
+ *     header | first[spans + 1] | arm_instruction[count] | text
+ * They are written to a temporary name and renamed into place, so
+ * concurrent runs sharing a directory never see a partial entry.
+ */
+class decode_cache {
+public:
+    decode_cache() = default; /* disabled */
+    explicit decode_cache(std::string directory);
+
+    /* uses the directory named by $ARM_DECODE_CACHE, if set */
+    static decode_cache from_environment();
+
+    bool enabled() const { return !m_directory.empty(); }
+
+    static uint64_t key(
+        const std::vector<arm_disassembler::span>& spans,
+        bool with_text = true);
+
+    bool load(
+        uint64_t key,
+        arm_disassembly& records,
+        std::vector<size_t>& first) const;
+
+    void store(
+        uint64_t key,
+        const arm_disassembly& records,
+        const std::vector<size_t>& first) const;
+
+    /* decode(spans, first) that is answered from the cache when it can */
+    arm_disassembly decode(
+        arm_disassembler& disassembler,
+        const std::vector<arm_disassembler::span>& spans,
+        std::vector<size_t>& first,
+        bool with_text = true) const;
+
+private:
+    std::string path(uint64_t key) const;
+
+    std::string m_directory;
+};
+
+#endif
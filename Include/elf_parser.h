@@ -2,7 +2,9 @@
 #define ELF_PARSER_H
 
 #include <iostream>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 #include "elf.h"
 
@@ -20,31 +22,44 @@ struct section_reloc {
 };
 
 struct section_t {
-    std::string name;
-    std::string raw_data;
+    std::string_view name;
+    std::string_view raw_data; /* view into object::image */
     std::vector<size_t> symbol_indices;
     std::vector<section_reloc> relocations;
+    /* indices into relocations ordered by offset; relocations sharing an
+       offset keep their relative order */
+    std::vector<size_t> relocations_by_offset;
     Elf32_Shdr header;
     size_t header_index;
 };
 
 struct object {
+    /* The file contents (a read-only mapping, or a copy when the file
+       could not be mapped); every string_view in the object points into
+       it, so it lives as long as any copy of the object does.  */
+    std::shared_ptr<const void> image;
+    std::string_view image_data;
+
     Elf32_Ehdr header;
 
     std::vector<Elf32_Shdr> section_headers;
-    std::vector<std::string> section_names;
-    std::vector<std::string> section_rawdata;
+    std::vector<std::string_view> section_names; /* views into image */
+    std::vector<std::string_view> section_rawdata;
 
     std::vector<Elf32_Sym> symbols;
-    std::vector<std::string> symbol_names;
+    std::vector<std::string_view> symbol_names; /* views into image */
     std::vector<struct reloc_entry> relocation_entries;
 
     std::vector<struct section_t> sections;
 };
 
 struct object ELF_parse(std::istream& file);
+struct object ELF_parse(const void* data, size_t size);
+bool ELF_parse_file(const std::string& filename, struct object& obj);
 
 void ELF_sort_section_syms_by_value(struct object& obj, size_t index);
 void ELF_sort_section_relocs_by_offset(struct object& obj, size_t index);
+void ELF_index_section_relocs(struct section_t& section);
+size_t ELF_find_section_reloc(const struct section_t& section, Elf32_Addr offset);
 
 #endif
@@ -2,6 +2,7 @@
 #define ELF_PRINTER_H
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include "elf_parser.h"
 
@@ -11,6 +12,6 @@ void ELF_print_relocations(const struct object& obj, std::vector<section_reloc>
 void ELF_print_section_header(const struct object& obj, size_t idx);
 void ELF_print_sections(const struct object& obj);
 void ELF_print_detailed_sections(const struct object& obj);
-void hexdump(const std::string& data);
+void hexdump(std::string_view data);
 
 #endif
@@ -0,0 +1,58 @@
+#ifndef PARALLEL_FOR_H
+#define PARALLEL_FOR_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Calls fn(i) for every i in [0, count) on up to `threads` workers
+ * (0 = one per hardware thread). Indices are handed out in increasing
+ * order, one at a time, so callers keep results in per-index slots and
+ * print them afterwards in their original order. The first exception
+ * thrown by fn stops the remaining work and is rethrown to the caller.
+ */
+template <typename F>
+void
+parallel_for(
+    size_t count,
+    F fn,
+    unsigned int threads = 0)
+{
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    threads = std::max(1u, (unsigned int)std::min<size_t>(threads, count));
+
+    if (threads <= 1) {
+        for (size_t i = 0; i < count; i++) fn(i);
+        return;
+    }
+
+    std::atomic<size_t> next(0);
+    std::exception_ptr error;
+    std::mutex error_lock;
+    auto worker = [&]() {
+        size_t i;
+        while ((i = next++) < count) {
+            try { fn(i); }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(error_lock);
+                if (!error) error = std::current_exception();
+                next = count;
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned int k = 1; k < threads; k++)
+        pool.emplace_back(worker);
+    worker();
+    for (auto& thread : pool) thread.join();
+
+    if (error) std::rethrow_exception(error);
+}
+
+#endif
@@ -0,0 +1,245 @@
+#include "decode_cache.h"
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* the last byte is the format version; bump it whenever the decoder's
+   output or arm_instruction changes so old entries stop matching */
+static const char cache_magic[8] = { 'A', 'R', 'M', 'D', 'E', 'C', 0, 4 };
+
+struct cache_header {
+    char     magic[8];
+    uint64_t key;
+    uint64_t spans;
+    uint64_t instructions;
+    uint64_t text_size;
+};
+
+
+static uint64_t
+fnv1a(
+    uint64_t hash,
+    const void* data,
+    size_t size)
+{
+    const unsigned char* p = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= p[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+
+static bool
+write_all(
+    int fd,
+    const void* data,
+    size_t size)
+{
+    const char* p = (const char*)data;
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n <= 0) return false;
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+
+// checks every size and offset in a mapped entry before copying it out
+static bool
+read_entry(
+    const char* data,
+    size_t size,
+    uint64_t key,
+    arm_disassembly& records,
+    std::vector<size_t>& first)
+{
+    cache_header header;
+    if (size < sizeof(header)) return false;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, cache_magic, sizeof(cache_magic)) != 0) return false;
+    if (header.key != key) return false;
+
+    size_t left = size - sizeof(header);
+    if (header.spans >= left / sizeof(uint64_t)) return false;
+    size_t first_size = (header.spans + 1) * sizeof(uint64_t);
+    left -= first_size;
+    if (header.instructions > left / sizeof(arm_instruction)) return false;
+    size_t records_size = header.instructions * sizeof(arm_instruction);
+    left -= records_size;
+    if (header.text_size != left) return false;
+
+    const char* p = data + sizeof(header);
+    std::vector<uint64_t> bounds(header.spans + 1);
+    memcpy(bounds.data(), p, first_size);
+    p += first_size;
+    if (bounds.front() != 0 || bounds.back() != header.instructions)
+        return false;
+    for (size_t k = 1; k < bounds.size(); k++)
+        if (bounds[k] < bounds[k - 1]) return false;
+
+    std::vector<arm_instruction> instructions(header.instructions);
+    memcpy(instructions.data(), p, records_size);
+    p += records_size;
+    for (size_t k = 0; k < instructions.size(); k++) {
+        const auto& instruction = instructions[k];
+        if (instruction.text > header.text_size ||
+            instruction.text_size > header.text_size - instruction.text)
+            return false;
+        if (instruction.mnemonic_size > instruction.comment ||
+            instruction.comment > instruction.text_size)
+            return false;
+        if (instruction.size < 1 || instruction.size > 4 ||
+            (instruction.flags & ~(ARM_INSN_THUMB | ARM_INSN_HAS_TARGET | ARM_INSN_DATA |
+                                   ARM_INSN_SETS_FLAGS)) ||
+            instruction.address > UINT32_MAX - (instruction.size - 1))
+            return false;
+    }
+    // arm_disassembly::find() relies on each span being in address order
+    for (size_t k = 0; k + 1 < bounds.size(); k++) {
+        for (size_t i = bounds[k] + 1; i < bounds[k + 1]; i++) {
+            const auto& previous = instructions[i - 1];
+            if (instructions[i].address < previous.address + previous.size)
+                return false;
+        }
+    }
+
+    records.instructions = std::move(instructions);
+    records.text.assign(p, header.text_size);
+    first.assign(bounds.begin(), bounds.end());
+    return true;
+}
+
+
+decode_cache::decode_cache(std::string directory)
+: m_directory(std::move(directory))
+{ }
+
+
+decode_cache
+decode_cache::from_environment()
+{
+    const char* directory = getenv(DECODE_CACHE_ENV);
+    if (directory == NULL || directory[0] == '\0') return decode_cache();
+    return decode_cache(directory);
+}
+
+
+uint64_t
+decode_cache::key(
+    const std::vector<arm_disassembler::span>& spans,
+    bool with_text)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    uint64_t settings[3] = {
+        sizeof(arm_instruction), with_text, spans.size() };
+    hash = fnv1a(hash, cache_magic, sizeof(cache_magic));
+    hash = fnv1a(hash, settings, sizeof(settings));
+    for (const auto& range : spans) {
+        uint64_t layout[2] = { range.vma, range.size };
+        hash = fnv1a(hash, layout, sizeof(layout));
+        hash = fnv1a(hash, range.data, range.size);
+        for (size_t k = 0; k < range.mapping_size; k++) {
+            uint64_t symbol[2] = {
+                range.mapping[k].address, (uint64_t)range.mapping[k].type };
+            hash = fnv1a(hash, symbol, sizeof(symbol));
+        }
+    }
+    return hash;
+}
+
+
+std::string
+decode_cache::path(uint64_t key) const
+{
+    char name[32];
+    snprintf(name, sizeof(name), "/%016llx.dec", (unsigned long long)key);
+    return m_directory + name;
+}
+
+
+bool
+decode_cache::load(
+    uint64_t key,
+    arm_disassembly& records,
+    std::vector<size_t>& first) const
+{
+    if (!enabled()) return false;
+
+    int fd = open(path(key).c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat info;
+    void* map = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && info.st_size > 0)
+        map = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return false;
+
+    bool found = read_entry((const char*)map, info.st_size, key, records, first);
+    munmap(map, info.st_size);
+    return found;
+}
+
+
+void
+decode_cache::store(
+    uint64_t key,
+    const arm_disassembly& records,
+    const std::vector<size_t>& first) const
+{
+    if (!enabled() || first.empty()) return;
+    mkdir(m_directory.c_str(), 0777); // the cache is best-effort
+
+    cache_header header;
+    memcpy(header.magic, cache_magic, sizeof(cache_magic));
+    header.key = key;
+    header.spans = first.size() - 1;
+    header.instructions = records.instructions.size();
+    header.text_size = records.text.size();
+    std::vector<uint64_t> bounds(first.begin(), first.end());
+
+    std::string target = path(key);
+    std::string temporary = target + ".XXXXXX";
+    int fd = mkstemp(&temporary[0]);
+    if (fd < 0) return;
+    fchmod(fd, 0644);
+
+    bool written =
+        write_all(fd, &header, sizeof(header)) &&
+        write_all(fd, bounds.data(), bounds.size() * sizeof(uint64_t)) &&
+        write_all(fd, records.instructions.data(),
+            records.instructions.size() * sizeof(arm_instruction)) &&
+        write_all(fd, records.text.data(), records.text.size());
+    written = (close(fd) == 0) && written;
+
+    if (!written || rename(temporary.c_str(), target.c_str()) != 0)
+        unlink(temporary.c_str());
+}
+
+
+arm_disassembly
+decode_cache::decode(
+    arm_disassembler& disassembler,
+    const std::vector<arm_disassembler::span>& spans,
+    std::vector<size_t>& first,
+    bool with_text) const
+{
+    if (!enabled()) return disassembler.decode(spans, first, with_text);
+
+    arm_disassembly records;
+    uint64_t hash = key(spans, with_text);
+    if (load(hash, records, first) && first.size() == spans.size() + 1)
+        return records;
+
+    records = disassembler.decode(spans, first, with_text);
+    store(hash, records, first);
+    return records;
+}
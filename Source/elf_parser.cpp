@@ -4,21 +4,37 @@
 
 #include "elf_parser.h"
 #include <iostream>
+#include <fstream>
+#include <iterator>
 #include <cassert>
 #include <cstring>
 #include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #define swap16(x) x = __builtin_bswap16(x)
 #define swap32(x) x = __builtin_bswap32(x)
 
 
+// NUL-terminated name at table[offset], as a view into the table
+static std::string_view
+ELF_string_at(
+    std::string_view table,
+    size_t offset)
+{
+    assert(offset < table.size());
+    table = table.substr(offset);
+    return table.substr(0, table.find('\0'));
+}
+
+
 static void
-ELF_parse_header(
-    std::istream& file,
-    struct object& obj)
+ELF_parse_header(struct object& obj)
 {
-    file.read((char*)&obj.header, sizeof(obj.header));
-    auto& hdr = obj.header;
+    assert(obj.image_data.size() >= sizeof(obj.header));
+    memcpy(&obj.header, obj.image_data.data(), sizeof(obj.header));
     assert(obj.header.e_ident[EI_MAG0] == 0x7F);
     assert(obj.header.e_ident[EI_MAG1] == 'E');
     assert(obj.header.e_ident[EI_MAG2] == 'L');
@@ -30,45 +46,42 @@ ELF_parse_header(
 
 
 static void
-ELF_read_section_data(
-    std::istream& file,
-    struct object& obj)
+ELF_read_section_data(struct object& obj)
 {
-    // TODO: do not read virtual sections
     obj.section_rawdata.resize(obj.section_headers.size());
     for (size_t i = 0; i < obj.section_headers.size(); i++) {
         if (obj.section_headers[i].sh_type == SHT_NOBITS) continue;
         auto offset = obj.section_headers[i].sh_offset;
         auto size = obj.section_headers[i].sh_size;
-        obj.section_rawdata[i].resize(size, '\0');
-        file.seekg(offset, std::ios_base::beg);
-        file.read(&obj.section_rawdata[i][0], obj.section_rawdata[i].size());
+        assert(offset <= obj.image_data.size());
+        assert(size <= obj.image_data.size() - offset);
+        obj.section_rawdata[i] = obj.image_data.substr(offset, size);
     }
 }
 
 
 static void
-ELF_parse_section_table(
-    std::istream& file,
-    struct object& obj)
+ELF_parse_section_table(struct object& obj)
 {
     if (obj.header.e_shoff == 0) return; // no section header
     assert(sizeof(Elf32_Shdr) == obj.header.e_shentsize);
 
-    file.seekg(obj.header.e_shoff, std::ios_base::beg);
+    size_t table_size = obj.header.e_shnum * obj.header.e_shentsize;
+    assert(obj.header.e_shoff <= obj.image_data.size());
+    assert(table_size <= obj.image_data.size() - obj.header.e_shoff);
     obj.section_headers.resize(obj.header.e_shnum);
-    file.read((char*)obj.section_headers.data(),
-        obj.header.e_shnum * obj.header.e_shentsize);
+    memcpy(obj.section_headers.data(),
+        obj.image_data.data() + obj.header.e_shoff, table_size);
 
-    ELF_read_section_data(file, obj);
+    ELF_read_section_data(obj);
 
     if (obj.header.e_shstrndx == SHN_UNDEF)
         obj.section_names.resize(obj.section_headers.size());
     else {
+        const auto& strtab = obj.section_rawdata[obj.header.e_shstrndx];
         for (size_t i = 0; i < obj.section_headers.size(); i++) {
             auto offset = obj.section_headers[i].sh_name;
-            obj.section_names.push_back(std::string(
-                &obj.section_rawdata[obj.header.e_shstrndx][offset]));
+            obj.section_names.push_back(ELF_string_at(strtab, offset));
         }
     }
 }
@@ -89,7 +102,7 @@ ELF_parse_symbol_table(struct object& obj)
         obj.symbols.resize(old_size + size);
         memcpy(
             (char*)&obj.symbols[old_size],
-            &obj.section_rawdata[i][0],
+            obj.section_rawdata[i].data(),
             size_in_bytes
         );
 
@@ -101,7 +114,7 @@ ELF_parse_symbol_table(struct object& obj)
             const auto& strtab = obj.section_rawdata[link];
             for (size_t j = 0; j < size; j++)
                 obj.symbol_names.push_back(
-                    std::string(&strtab[obj.symbols[j].st_name]));
+                    ELF_string_at(strtab, obj.symbols[j].st_name));
         }
     }
 }
@@ -121,7 +134,7 @@ ELF_parse_relocations(struct object& obj)
         assert(sizeof(Elf32_Rel) == entry_size);
         memcpy(
             (char*)&table[0],
-            &obj.section_rawdata[i][0],
+            obj.section_rawdata[i].data(),
             size_in_bytes
         );
 
@@ -149,6 +162,21 @@ ELF_organize_sections(struct object& obj)
         tagged_sections.push_back(obj.symbols[i].st_shndx);
     }
 
+    // bucket symbols and SHT_REL tables by the section they refer to,
+    // keeping index order within each bucket
+    size_t section_count = obj.section_headers.size();
+    std::vector<std::vector<size_t>> section_symbols(section_count);
+    std::vector<std::vector<size_t>> section_rel_tables(section_count);
+    for (size_t i = 0; i < obj.symbols.size(); i++) {
+        if (obj.symbols[i].st_shndx < section_count)
+            section_symbols[obj.symbols[i].st_shndx].push_back(i);
+    }
+    for (size_t i = 0; i < section_count; i++) {
+        if (obj.section_headers[i].sh_type == SHT_REL &&
+            obj.section_headers[i].sh_info < section_count)
+            section_rel_tables[obj.section_headers[i].sh_info].push_back(i);
+    }
+
     for (auto sidx : tagged_sections) {
         if (sidx >= obj.section_headers.size()) continue;
 
@@ -162,14 +190,9 @@ ELF_organize_sections(struct object& obj)
         section.name = obj.section_names[sidx];
         section.raw_data = obj.section_rawdata[sidx];
 
-        for (size_t i = 0; i < obj.symbols.size(); i++) {
-            if (obj.symbols[i].st_shndx == sidx)
-                section.symbol_indices.push_back(i);
-        }
+        section.symbol_indices = section_symbols[sidx];
 
-        for (size_t i = 0; i < obj.section_headers.size(); i++) {
-            if (obj.section_headers[i].sh_type != SHT_REL ||
-                obj.section_headers[i].sh_info != sidx) continue;
+        for (auto i : section_rel_tables[sidx]) {
             auto size_in_bytes = obj.section_headers[i].sh_size;
             auto entry_size = obj.section_headers[i].sh_entsize;
             auto size = size_in_bytes / entry_size;
@@ -178,7 +201,7 @@ ELF_organize_sections(struct object& obj)
             assert(sizeof(Elf32_Rel) == entry_size);
             memcpy(
                 (char*)&table[0],
-                &obj.section_rawdata[i][0],
+                obj.section_rawdata[i].data(),
                 size_in_bytes
             );
             auto link = obj.section_headers[i].sh_link;
@@ -193,18 +216,22 @@ ELF_organize_sections(struct object& obj)
             }
         }
 
-        obj.sections.push_back(section);
+        ELF_index_section_relocs(section);
+        obj.sections.push_back(std::move(section));
     }
 }
 
 
 struct object
-ELF_parse(std::istream& file)
+ELF_parse(
+    const void* data,
+    size_t size)
 {
     struct object result;
+    result.image_data = std::string_view((const char*)data, size);
 
-    ELF_parse_header(file, result);
-    ELF_parse_section_table(file, result);
+    ELF_parse_header(result);
+    ELF_parse_section_table(result);
     ELF_parse_symbol_table(result);
     ELF_parse_relocations(result);
 
@@ -214,6 +241,50 @@ ELF_parse(std::istream& file)
 }
 
 
+struct object
+ELF_parse(std::istream& file)
+{
+    auto buffer = std::make_shared<std::string>(
+        std::istreambuf_iterator<char>(file),
+        std::istreambuf_iterator<char>());
+    struct object result = ELF_parse(buffer->data(), buffer->size());
+    result.image = buffer;
+    return result;
+}
+
+
+bool
+ELF_parse_file(
+    const std::string& filename,
+    struct object& obj)
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat info;
+    void* map = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0)
+        map = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if (map == MAP_FAILED) {
+        // pipes and other unmappable files are read through a stream
+        close(fd);
+        std::ifstream file(filename, std::ios_base::binary);
+        if (!file.is_open()) return false;
+        obj = ELF_parse(file);
+        return true;
+    }
+    close(fd);
+
+    size_t size = info.st_size;
+    std::shared_ptr<const void> image(map,
+        [size](const void* p) { munmap((void*)p, size); });
+    obj = ELF_parse(map, size);
+    obj.image = image;
+    return true;
+}
+
+
 void
 ELF_sort_section_syms_by_value(
     struct object& obj,
@@ -247,4 +318,39 @@ ELF_sort_section_relocs_by_offset(
             return a.offset < b.offset;
         }
     );
+    ELF_index_section_relocs(obj.sections[index]);
+}
+
+
+void
+ELF_index_section_relocs(struct section_t& section)
+{
+    auto& order = section.relocations_by_offset;
+    order.resize(section.relocations.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = i;
+    std::stable_sort(order.begin(), order.end(),
+        [&](size_t a, size_t b) {
+            return section.relocations[a].offset <
+                section.relocations[b].offset;
+        }
+    );
+}
+
+
+/**
+ * Position in relocations_by_offset of the first relocation at or after
+ * offset (relocations_by_offset.size() if there is none).
+ */
+size_t
+ELF_find_section_reloc(
+    const struct section_t& section,
+    Elf32_Addr offset)
+{
+    const auto& order = section.relocations_by_offset;
+    auto it = std::lower_bound(order.begin(), order.end(), offset,
+        [&](size_t index, Elf32_Addr value) {
+            return section.relocations[index].offset < value;
+        }
+    );
+    return it - order.begin();
 }
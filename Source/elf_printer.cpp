@@ -481,7 +481,7 @@ ELF_print_detailed_sections(const struct object& obj)
 
 
 void
-hexdump(const std::string& data)
+hexdump(std::string_view data)
 {
     if (data.size() == 0) return;
     std::cout << std::setfill('0');
@@ -13,12 +13,15 @@
 #include "elf_printer.h"
 #include "arm_disassembler.h"
 #include "arm_decompiler.h"
+#include "decode_cache.h"
+#include "parallel_for.h"
 
 struct funcsym {
     unsigned int start;
     unsigned int size;
     std::string name;
     bool ispublic;
+    bool thumb;
 };
 
 
@@ -33,9 +36,10 @@ filter_function_symbols(
         const auto& symbol = obj.symbols[section.symbol_indices[j]];
         const auto& name = obj.symbol_names[section.symbol_indices[j]];
         if (ELF32_ST_TYPE(symbol.st_info) != STT_FUNC) continue;
+        unsigned int start = symbol.st_value & ~1u; // bit 0 marks Thumb
         
         auto f = std::find_if(functions.begin(), functions.end(),
-        [&](const funcsym& sym) { return sym.start == symbol.st_value; });
+        [&](const funcsym& sym) { return sym.start == start; });
         if (f != functions.end()) {
             if (ELF32_ST_BIND(symbol.st_info) == STB_GLOBAL) {
                 f->name = name;
@@ -47,8 +51,9 @@ filter_function_symbols(
             funcsym func;
             func.name = name;
             func.ispublic = ELF32_ST_BIND(symbol.st_info) == STB_GLOBAL;
-            func.start = symbol.st_value;
+            func.start = start;
             func.size = symbol.st_size;
+            func.thumb = symbol.st_value & 1;
             functions.push_back(func);
         }
     }
@@ -56,6 +61,34 @@ filter_function_symbols(
 }
 
 
+/**
+ * The section's $a/$t/$d mapping symbols in address order. Objects without
+ * any fall back to the mode implied by each function symbol.
+ */
+static std::vector<arm_mapping>
+section_mapping(
+    const struct object& obj,
+    size_t sidx,
+    const std::vector<funcsym>& functions)
+{
+    const auto& section = obj.sections[sidx];
+    std::vector<arm_mapping> mapping;
+    for (auto k : section.symbol_indices) {
+        char type = arm_mapping_type(obj.symbol_names[k]);
+        if (type != 0) mapping.push_back({ obj.symbols[k].st_value, type });
+    }
+    if (mapping.size() == 0) {
+        for (const auto& f : functions)
+            mapping.push_back({ f.start, f.thumb ? 't' : 'a' });
+    }
+    std::stable_sort(mapping.begin(), mapping.end(),
+        [](const arm_mapping& a, const arm_mapping& b) {
+            return a.address < b.address;
+        });
+    return mapping;
+}
+
+
 static void
 reformat_strings(std::vector<std::string>& array)
 {
@@ -93,14 +126,20 @@ reformat_strings(std::vector<std::string>& array)
 static void
 relocate_syms(
     std::vector<std::string>& array,
-    struct object& obj,
-    size_t sec_idx)
+    const arm_disassembly& records,
+    size_t first,
+    const struct object& obj,
+    size_t sec_idx,
+    size_t start,
+    size_t end)
 {
     const auto& section = obj.sections[sec_idx];
-    ELF_sort_section_relocs_by_offset(obj, sec_idx);
+    const auto& order = section.relocations_by_offset;
     std::ostringstream os;
-    for (const auto& r : section.relocations) {
-        size_t aidx = r.offset / 4;
+    for (size_t k = ELF_find_section_reloc(section, start); k < order.size(); k++) {
+        const auto& r = section.relocations[order[k]];
+        if (r.offset >= end) break;
+        size_t aidx = records.find(r.offset, first, first + array.size()) - first;
         assert(aidx < array.size());
         auto& line = array[aidx];
         os.str("");
@@ -117,18 +156,21 @@ relocate_syms(
 static void
 relocate(
     std::vector<std::string>& array,
+    const arm_disassembly& records,
+    size_t first,
     const struct object& obj,
     size_t sidx,
     size_t fidx)
 {
     const auto& section = obj.sections[sidx];
-    for (size_t i = 0, pc = fidx; i < array.size(); i++, pc += 4) {
-        auto reloc = std::find_if(
-            section.relocations.begin(),
-            section.relocations.end(),
-            [=](const section_reloc& token)
-            { return token.offset == pc; });
-        if (reloc != section.relocations.end()) {
+    const auto& order = section.relocations_by_offset;
+    size_t k = ELF_find_section_reloc(section, fidx);
+    for (size_t i = 0; i < array.size(); i++) {
+        size_t pc = records.instructions[first + i].address;
+        // merge-join: advance through the offset-ordered relocations
+        while (k < order.size() && section.relocations[order[k]].offset < pc) k++;
+        if (k < order.size() && section.relocations[order[k]].offset == pc) {
+            const auto* reloc = &section.relocations[order[k]];
             std::ostringstream os;
             if (array[i].find("BL ") == 0)
                 os << std::setw(13) << std::left << "BL" << std::right;
@@ -147,20 +189,26 @@ relocate(
 static void
 labelify(
     std::vector<std::string>& array,
-    size_t fidx,
-    std::string name)
+    const arm_disassembly& records,
+    size_t first,
+    uint32_t start,
+    const std::string& name)
 {
-    typedef std::pair<size_t,std::string> label_t;
-    std::vector<size_t> indices;
-    std::vector<label_t> labels;
-
-    // find all branch instructions (except BX and BL)
+    // array[i] is the text of records.instructions[first + i], and the
+    // function starts at address start
+    //
+    // label number of each instruction that is a branch target, -1 if none;
+    // labels are numbered in the order their first branch is seen
+    std::vector<int> label_at(array.size(), -1);
+    int label_count = 0;
+
+    // rewrite branches (except BX and BL) with a decoded target
     for (size_t i = 0; i < array.size(); i++) {
         if (array[i][0] != 'B') continue;
         char c1 = array[i][1];
         char c2 = array[i][2];
-        if (c1 == ' ') indices.push_back(i);
-        else if (
+        if (!(
+            (c1 == ' ') ||
             (c1 == 'E' &&  c2 == 'Q') ||
             (c1 == 'N' &&  c2 == 'E') ||
             (c1 == 'C' && (c2 == 'S'  || c2 == 'C')) ||
@@ -170,84 +218,60 @@ labelify(
             (c1 == 'P' &&  c2 == 'L') ||
             (c1 == 'V' && (c2 == 'S'  || c2 == 'C')) ||
             (c1 == 'G' && (c2 == 'E'  || c2 == 'T')) ||
-            (c1 == 'A' &&  c2 == 'L'))
-            indices.push_back(i);
+            (c1 == 'A' &&  c2 == 'L')))
+            continue;
+
+        // only targets that start an instruction of this function get a label
+        const auto& insn = records.instructions[first + i];
+        if (!(insn.flags & ARM_INSN_HAS_TARGET)) continue;
+        size_t n = records.find(insn.target, first, first + array.size()) - first;
+        if (n >= array.size()) continue;
+        if (records.instructions[first + n].address != insn.target) continue;
+        if (label_at[n] < 0) label_at[n] = label_count++;
+
+        // rewrite instruction with new label, keeping any trailing comment
+        const auto& line = array[i];
+        auto comment = line.find('@');
+        std::ostringstream os;
+        os << std::setw(13) << std::left << line.substr(0, line.find(' '));
+        os << std::right << ".L" << name << "." << label_at[n];
+        {
+            auto size = os.str().size();
+            size = 42 - size;
+            os << std::setw(size) << "@";
+        }
+        os << " <" << name << "+0x" << std::hex << (insn.target - start) << ">";
+        if (comment != std::string::npos)
+            os << line.substr(comment + 1);
+        array[i] = os.str();
     }
 
-    // extract branch addresses (ignoring non-address branches)
-    for (auto i : indices) {
-        std::istringstream iss(array[i]);
-        std::vector<std::string> tokens(
-            std::istream_iterator<std::string>{iss},
-            std::istream_iterator<std::string>());
-        assert(tokens.size() >= 2);
-        char* p;
-        unsigned long n = strtoul(tokens[1].c_str(), &p, 16); 
-        if (*p == 0) {
-            if ((n % 4) != 0) {
-                std::cerr << (n % 4) << " != 0" << std::endl;
-                assert(false);
-            }
-            else n /= 4;
-            if (n >= array.size()) {
-                // hack for times when branch addresses are
-                // absolute instead of relative
-                n -= (fidx / 4);
-            }
-            if (n >= array.size()) {
-                std::cerr << n << " < " << array.size();
-                std::cerr << " " << array[i];
-                std::cerr << " function_id: " << (fidx) << ":" << (fidx>>2);
-                std::cerr << std::endl;
-                assert(false);
-            }
+    if (label_count == 0) return;
 
-            auto f = std::find_if(labels.begin(), labels.end(),
-            [=](const label_t& l) { return l.first == n; });
-
-            label_t label_info;
-            if (f != labels.end()) label_info = *f;
-            else {
-                std::ostringstream os;
-                os << ".L" << name << "." << labels.size();
-                label_info.first = n;
-                label_info.second = os.str();
-                labels.push_back(label_info);
-            }
-
-            // rewrite instruction with new label
+    // one pass writing each label (after a blank line) ahead of its target
+    std::vector<std::string> labeled;
+    labeled.reserve(array.size() + 2 * label_count);
+    for (size_t i = 0; i < array.size(); i++) {
+        if (label_at[i] >= 0) {
             std::ostringstream os;
-            os << std::setw(13) << std::left << tokens[0] << std::right;
-            os << label_info.second;
-            {
-                auto size = os.str().size();
-                size = 42 - size;
-                os << std::setw(size) << "@";
-            }
-            os << " <" << name << "+0x" << std::hex << (label_info.first) << ">";
-            for (size_t k = 3; k < tokens.size(); k++)
-                // k=0 (command) k=1 (old address) k=2 (@ for comments)
-                os << " " << tokens[i];
-            array[i] = os.str();
+            os << ".L" << name << "." << label_at[i] << ":";
+            labeled.emplace_back();
+            labeled.push_back(os.str());
         }
+        labeled.push_back(std::move(array[i]));
     }
+    array.swap(labeled);
+}
 
-    // sort labels to make inserting them easier
-    std::sort(labels.begin(), labels.end(), std::greater<label_t>());
-
-    for (auto& label : labels)
-        assert(label.first < array.size());
 
-    for (const auto& label : labels) {
-        if (label.first >= array.size()) {
-            std::cerr << "Assert: (" << label.first << " < " << array.size() << ")" << std::endl;
-            assert(false);
-        }
-        std::string label_name = label.second;
-        label_name.append(":");
-        array.insert(array.begin() + label.first, label_name);
-        array.insert(array.begin() + label.first, std::string());
-    }    
+// NUL-terminated string at data[offset], bounded by the end of the view
+static std::string
+c_string_at(
+    std::string_view data,
+    size_t offset)
+{
+    data = data.substr(offset);
+    return std::string(data.substr(0, data.find('\0')));
 }
 
 
@@ -295,6 +319,7 @@ escape_string(const std::string& str)
 static void
 print_disassembly(struct object& obj)
 {
+    arm_disassembler disassembler;
     for (size_t i = 0; i < obj.sections.size(); i++) {
         const auto& section = obj.sections[i];
         if (section.header.sh_type != SHT_PROGBITS) continue;
@@ -303,16 +328,28 @@ print_disassembly(struct object& obj)
 
         if (functions.size() == 0) continue;
         std::cout << "@ " << section.name << "\n\n";
+        auto mapping = section_mapping(obj, i, functions);
+
+        // each function is decoded on its own, at its section address
+        std::vector<arm_disassembler::span> spans;
+        for (const auto& f : functions) {
+            auto size = std::min<size_t>(f.size,
+                section.raw_data.size() - std::min<size_t>(f.start,
+                section.raw_data.size()));
+            spans.push_back({ section.raw_data.data() + f.start, size, f.start,
+                mapping.data(), mapping.size() });
+        }
+        std::vector<size_t> first;
+        auto records = disassembler.decode(spans, first);
 
         for (size_t k = 0; k < functions.size(); k++) {
             const auto& f = functions[k];
-            std::string chunk = section.raw_data.substr(f.start, f.size);
-            auto assembly = disassemble2array(chunk);
+            auto assembly = records.lines(first[k], first[k + 1]);
             reformat_strings(assembly);
-            relocate(assembly, obj, i, f.start);
-            labelify(assembly, f.start, f.name);
+            relocate(assembly, records, first[k], obj, i, f.start);
+            labelify(assembly, records, first[k], f.start, f.name);
             std::cout << "FUNC_BEGIN " << f.name << "\n";
-            for (size_t j = 0, pc = f.start; j < assembly.size(); j++, pc += 4)
+            for (size_t j = 0; j < assembly.size(); j++)
                 std::cout << "    " << assembly[j] << "\n";
             std::cout << "FUNC_END " << f.name << "\n\n";
         }
@@ -329,8 +366,8 @@ print_disassembly(struct object& obj)
         for (size_t k = 0; k < section.symbol_indices.size(); k++) {
             const auto& symbol = obj.symbols[section.symbol_indices[k]];
             const auto& symname = obj.symbol_names[section.symbol_indices[k]];
-            if (symname[0] == '$') continue;
             if (symname.size() == 0) continue;
+            if (symname[0] == '$') continue;
 
             if (ELF32_ST_TYPE(symbol.st_info) == STT_OBJECT) {
                 std::cout << "@ var " << symname << " at 0x";
@@ -345,13 +382,13 @@ print_disassembly(struct object& obj)
             if (section.header.sh_type == SHT_PROGBITS) {
                 assert(symbol.st_value < section.raw_data.size());
                 if (symbol.st_size == 0) {
-                    std::string d(&section.raw_data[symbol.st_value]);
+                    std::string d = c_string_at(section.raw_data, symbol.st_value);
                     d = escape_string(d);
                     std::cout << "\"" << d << "\"";
                 }
                 else {
-                    std::string d = section.raw_data.substr(
-                        symbol.st_value, symbol.st_size);
+                    std::string d(section.raw_data.substr(
+                        symbol.st_value, symbol.st_size));
                     if (is_ascii(d)) {
                         d = escape_string(d);
                         std::cout << "\"" << d << "\"";
@@ -428,7 +465,7 @@ print_strings(struct object& obj)
                 if (ELF32_ST_TYPE(sym.st_info) != STT_NOTYPE &&
                     ELF32_ST_TYPE(sym.st_info) != STT_OBJECT) continue;
 
-                std::string str(&section.raw_data[sym.st_value]);
+                std::string str = c_string_at(section.raw_data, sym.st_value);
                 std::cout << std::left;
                 std::cout << std::setw(10) << std::hex << obj.symbols[sym_idx].st_value;
                 std::cout << std::setw(35) << obj.symbol_names[sym_idx];
@@ -448,9 +485,44 @@ print_strings(struct object& obj)
 }
 
 
+// appends the records of from to to, moving their text offsets along
+static void
+append_records(
+    arm_disassembly& to,
+    const arm_disassembly& from)
+{
+    size_t base = to.text.size();
+    to.text.append(from.text);
+    for (auto instruction : from.instructions) {
+        instruction.text += base;
+        to.instructions.push_back(instruction);
+    }
+}
+
+
 static void
 main_disassemble(struct object& obj)
 {
+    struct shard {
+        size_t section;
+        size_t span; /* index of the function in its section_decode */
+        funcsym function;
+        arm_disassembly records; /* kept only to fill the decode cache */
+        std::string output;
+    };
+
+    /* the function spans of one section, as one decode cache entry */
+    struct section_decode {
+        std::vector<arm_mapping> mapping;
+        std::vector<arm_disassembler::span> spans;
+        arm_disassembly records;
+        std::vector<size_t> first;
+        bool cached = false;
+    };
+
+    std::vector<std::vector<size_t>> section_shards(obj.sections.size());
+    std::vector<section_decode> decodes(obj.sections.size());
+    std::vector<shard> shards;
     for (size_t i = 0; i < obj.sections.size(); i++) {
         const auto& section = obj.sections[i];
 
@@ -466,37 +538,86 @@ main_disassemble(struct object& obj)
                 return a.start < b.start;
             }
         );
+        ELF_sort_section_relocs_by_offset(obj, i);
+        decodes[i].mapping = section_mapping(obj, i, functions);
 
-        std::cout << "@ " << section.name << "\n\n";
+        for (const auto& f : functions) {
+            if (f.start + f.size > section.raw_data.size()) {
+                std::cerr << "ERROR: \n";
+                std::cerr << "f_start: " << f.start << " < " << section.raw_data.size() << "\n";
+                std::cerr << "f_end:   " << (f.start + f.size) << " < " << section.raw_data.size() << std::endl;
+            }
+            assert(f.start + f.size <= section.raw_data.size());
+            section_shards[i].push_back(shards.size());
+            shards.push_back({ i, decodes[i].spans.size(), f,
+                arm_disassembly(), std::string() });
+            decodes[i].spans.push_back(
+                { section.raw_data.data() + f.start, f.size, f.start,
+                  decodes[i].mapping.data(), decodes[i].mapping.size() });
+        }
+    }
 
-        auto asm_strings = disassemble2array(section.raw_data);
-        reformat_strings(asm_strings);
-        relocate_syms(asm_strings, obj, i);
+    // sections found in the decode cache skip libopcodes entirely
+    decode_cache cache = decode_cache::from_environment();
+    for (size_t i = 0; i < obj.sections.size(); i++) {
+        auto& d = decodes[i];
+        if (d.spans.size() == 0) continue;
+        d.cached = cache.load(decode_cache::key(d.spans), d.records, d.first) &&
+            d.first.size() == d.spans.size() + 1;
+    }
 
-        for (size_t k = 0; k < functions.size(); k++) {
-            const auto& f = functions[k];
-            auto f_start = f.start / 4;
-            auto f_end = ((f.start + f.size) / 4);
+    // decode, annotate and label each function on its own; the section
+    // addresses are kept so the output matches a whole-section decode
+    parallel_for(shards.size(), [&](size_t k) {
+        thread_local arm_disassembler disassembler;
+        auto& s = shards[k];
+        const auto& f = s.function;
+        const auto& d = decodes[s.section];
+
+        arm_disassembly decoded;
+        const arm_disassembly* records = &decoded;
+        size_t first = 0, last;
+        if (d.cached) {
+            records = &d.records;
+            first = d.first[s.span];
+            last = d.first[s.span + 1];
+        }
+        else {
+            decoded.text.reserve(f.size * 8 + 64);
+            disassembler.decode(d.spans[s.span], decoded);
+            last = decoded.instructions.size();
+        }
 
-            if (!((f_start < asm_strings.size()) && (f_end <= asm_strings.size()))) {
-                std::cerr << "ERROR: \n";
-                std::cerr << "f_start: " << f_start << " < " << asm_strings.size() << "\n";
-                std::cerr << "f_end:   " << f_end   << " < " << asm_strings.size() << std::endl;
-            }
-            assert((f_start < asm_strings.size()) && (f_end <= asm_strings.size()));
+        auto func_asm = records->lines(first, last);
+        reformat_strings(func_asm);
+        relocate_syms(func_asm, *records, first, obj, s.section, f.start, f.start + f.size);
+        labelify(func_asm, *records, first, f.start, f.name);
 
-            std::vector<std::string> func_asm(
-                asm_strings.begin() + f_start,
-                asm_strings.begin() + f_end
-            );
-            labelify(func_asm, f.start, f.name);
+        std::ostringstream os;
+        os << "FUNC_BEGIN " << f.name << "\n";
+        for (const auto& line : func_asm)
+            os << "    " << line << "\n";
+        os << "FUNC_END " << f.name << "\n\n";
+        s.output = os.str();
+        if (!d.cached && cache.enabled()) s.records = std::move(decoded);
+    });
 
-            std::cout << "FUNC_BEGIN " << f.name << "\n";
-            for (const auto& line : func_asm)
-                std::cout << "    " << line << "\n";
-            std::cout << "FUNC_END " << f.name << "\n\n";    
+    for (size_t i = 0; i < obj.sections.size(); i++) {
+        auto& d = decodes[i];
+        if (d.cached || !cache.enabled() || d.spans.size() == 0) continue;
+        for (auto k : section_shards[i]) {
+            d.first.push_back(d.records.instructions.size());
+            append_records(d.records, shards[k].records);
         }
+        d.first.push_back(d.records.instructions.size());
+        cache.store(decode_cache::key(d.spans), d.records, d.first);
+    }
 
+    for (size_t i = 0; i < obj.sections.size(); i++) {
+        if (section_shards[i].size() == 0) continue;
+        std::cout << "@ " << obj.sections[i].name << "\n\n";
+        for (auto k : section_shards[i])
+            std::cout << shards[k].output;
         std::cout << "\n\n";
     }
 }
@@ -506,16 +627,15 @@ int main(int argc, char** argv) {
     if (argc < 2) {
         std::cout << "Usage: " << argv[0] << " <obj-file> [p/s/d/t]\n";
         std::cout << "t: print target section; 't .bss' - default .text\n";
+        std::cout << "set " DECODE_CACHE_ENV "=<dir> to cache decoded sections\n";
         return -1;
     }
 
-    std::ifstream objfile(argv[1]);
-    if (!objfile.is_open()) {
+    struct object obj;
+    if (!ELF_parse_file(argv[1], obj)) {
         std::cout << "could not open file " << argv[1] << std::endl;
         return -1;
     }
-    struct object obj = ELF_parse(objfile);
-    objfile.close();
 
     if (argc > 2) {
         switch (argv[2][0]) {
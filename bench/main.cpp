@@ -0,0 +1,477 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "arm_disassembler.h"
+#include "arm/instruction.h"
+#include "elf_parser.h"
+#include "libopcodes_config.h"
+#include "dis-asm.h"
+
+
+/**
+ * Heap allocations made through operator new, counted so the decode
+ * benchmark can report them per record. libopcodes' own mallocs are not
+ * seen, but it makes none per instruction.
+ */
+static std::atomic<uint64_t> allocations;
+
+void* operator new(size_t size) {
+    allocations++;
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+
+static uint32_t random_state = 0x2545f491;
+
+// small deterministic generator, so runs are comparable
+static uint32_t next_random() {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+
+/**
+ * A synthetic code image: ARM words with the AL condition, or a Thumb-2
+ * stream mixing 16-bit, 32-bit and IT instructions, with no symbols.
+ */
+static std::string synthetic_image(size_t size, bool thumb) {
+    std::string image;
+    image.reserve(size + 4);
+    while (image.size() < size) {
+        uint32_t word = next_random();
+        if (!thumb) {
+            word = (word & 0x0fffffff) | 0xe0000000;
+            image.append((const char*)&word, 4);
+            continue;
+        }
+        uint16_t half = word & 0xffff;
+        switch ((word >> 16) % 8) {
+        case 0: half = 0xbf00 | ((word >> 20) & 0xe0) | 0x08; break; // IT
+        case 1: half = 0xf000 | (half & 0x07ff); break;              // 32-bit prefix
+        default: if ((half & 0xf800) >= 0xe800) half &= 0x7fff; break;
+        }
+        image.append((const char*)&half, 2);
+        if ((half & 0xf800) >= 0xe800) {
+            uint16_t second = word >> 16;
+            image.append((const char*)&second, 2);
+        }
+    }
+    return image;
+}
+
+
+// Thumb code of 16-bit instructions only: no 32-bit prefixes and no IT
+static std::string synthetic_thumb16(size_t size) {
+    std::string image;
+    image.reserve(size);
+    while (image.size() < size) {
+        uint16_t half = next_random() & 0xffff;
+        if ((half & 0xf800) >= 0xe800) half &= 0x7fff;
+        if ((half & 0xff00) == 0xbf00) half &= 0xfff0; // IT becomes a hint
+        image.append((const char*)&half, 2);
+    }
+    return image;
+}
+
+
+static bool read_file(const char* path, std::string& image) {
+    std::ifstream file(path, std::ios_base::binary);
+    if (!file.is_open()) return false;
+    image.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+
+struct timing {
+    double nanoseconds; // best run
+    size_t records;
+    uint64_t allocations;
+};
+
+template <typename F>
+static timing best_of(int runs, F decode) {
+    timing best = { 1e30, 0, 0 };
+    for (int r = 0; r < runs; r++) {
+        uint64_t before = allocations;
+        auto start = std::chrono::steady_clock::now();
+        size_t records = decode();
+        auto stop = std::chrono::steady_clock::now();
+        double ns = std::chrono::duration<double, std::nano>(stop - start).count();
+        if (ns < best.nanoseconds) best = { ns, records, allocations - before };
+    }
+    return best;
+}
+
+static void report(const char* name, const timing& t) {
+    std::cout << std::left << std::setw(24) << name << std::right << std::fixed
+        << std::setprecision(1) << std::setw(8) << t.nanoseconds / t.records << " ns/record "
+        << std::setprecision(3) << std::setw(8) << (double)t.allocations / t.records << " allocs/record "
+        << std::setw(9) << t.records << " records\n";
+}
+
+
+/**
+ * ns per record and heap allocations per record for one image, decoded
+ * with and without text, through a reused context and the memo, and
+ * through the one-shot disassemble2array() wrapper.
+ */
+static int bench_decode(const std::string& image, char mode, int runs) {
+    arm_mapping mapping = { 0, mode };
+    arm_disassembler::span range = { image.data(), image.size(), 0, &mapping, 1 };
+    arm_disassembler disassembler;
+
+    auto reused = [&](bool with_text) {
+        return [&, with_text]() {
+            arm_disassembly records;
+            disassembler.decode(range, records, with_text);
+            return records.instructions.size();
+        };
+    };
+
+    report("text", best_of(runs, reused(true)));
+    report("records only", best_of(runs, reused(false)));
+
+    disassembler.memoize(true);
+    auto before = arm_disassembler::totals();
+    report("text, memoized", best_of(runs, reused(true)));
+    auto after = arm_disassembler::totals();
+    disassembler.memoize(false);
+    uint64_t hits = after.memo_hits - before.memo_hits;
+    uint64_t lookups = hits + after.memo_misses - before.memo_misses;
+    std::cout << "  memo hit rate " << std::setprecision(1)
+        << (lookups ? 100.0 * hits / lookups : 0.0) << "%\n";
+
+    if (mode == 'a') {
+        report("disassemble2array", best_of(runs, [&]() {
+            return disassemble2array(image).size();
+        }));
+    }
+    return 0;
+}
+
+
+static bool same_records(const arm_disassembly& a, const arm_disassembly& b) {
+    if (a.text != b.text || a.instructions.size() != b.instructions.size()) return false;
+    for (size_t i = 0; i < a.instructions.size(); i++) {
+        const auto& x = a.instructions[i];
+        const auto& y = b.instructions[i];
+        if (x.address != y.address || x.word != y.word || x.target != y.target ||
+            x.opcode != y.opcode || x.text != y.text || x.text_size != y.text_size ||
+            x.mnemonic_size != y.mnemonic_size || x.comment != y.comment ||
+            x.size != y.size || x.condition != y.condition || x.type != y.type ||
+            x.flags != y.flags)
+            return false;
+    }
+    return true;
+}
+
+
+/**
+ * ns per record for one image decoded without text through libopcodes'
+ * dispatch tables, then with only the ARM_DISPATCH_* lookups in enabled
+ * left on, so the rest fall back to the reference linear scan of the
+ * opcode tables. Fails unless both decodes give the same records, with
+ * and without text.
+ */
+static int compare_lookups(const std::string& image, char mode, int runs,
+                           const char* name, int enabled) {
+    arm_mapping mapping = { 0, mode };
+    arm_disassembler::span range = { image.data(), image.size(), 0, &mapping, 1 };
+    arm_disassembler disassembler;
+    auto decode = [&](arm_disassembly& records) {
+        return [&]() {
+            records = arm_disassembly();
+            disassembler.decode(range, records, false);
+            return records.instructions.size();
+        };
+    };
+
+    arm_disassembly tables, scan;
+    timing fast = best_of(runs, decode(tables));
+    arm_set_dispatch(enabled);
+    timing slow = best_of(runs, decode(scan));
+    arm_disassembly tables_text, scan_text;
+    disassembler.decode(range, scan_text);
+    arm_set_dispatch(ARM_DISPATCH_ALL);
+    disassembler.decode(range, tables_text);
+
+    bool same = same_records(tables, scan) && same_records(tables_text, scan_text);
+    report("records, dispatch", fast);
+    report(name, slow);
+    std::cout << "  dispatch " << std::setprecision(2) << slow.nanoseconds / fast.nanoseconds
+        << "x faster, " << (same ? "same records" : "RECORDS DIFFER") << "\n";
+    return same ? 0 : 1;
+}
+
+
+/**
+ * Decodes one image on n threads at once and fails unless every result is
+ * byte-identical to a single-threaded decode. Each thread alternates
+ * between its own long-lived context and one-shot disassemble2array()
+ * calls, so decoder state is both reused and created concurrently.
+ */
+static int stress_threads(unsigned threads, int rounds) {
+    std::string image = synthetic_image(1 << 17, false);
+    std::string thumb = synthetic_image(1 << 17, true);
+    std::vector<arm_mapping> mapping;
+    for (uint32_t address = 0; address < image.size(); address += 1 << 14) {
+        mapping.push_back({ address, 'a' });
+        mapping.push_back({ address + (1 << 13), 't' });
+    }
+    // the second half of every 16 KB block is Thumb code
+    for (const auto& m : mapping) {
+        if (m.type == 't') image.replace(m.address, 1 << 13, thumb, m.address, 1 << 13);
+    }
+    arm_disassembler::span range = {
+        image.data(), image.size(), 0, mapping.data(), mapping.size() };
+
+    arm_disassembly expected;
+    arm_disassembler().decode(range, expected);
+    auto expected_lines = disassemble2array(image);
+
+    std::atomic<unsigned> failures(0);
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; t++) {
+        workers.emplace_back([&]() {
+            arm_disassembler disassembler;
+            for (int r = 0; r < rounds; r++) {
+                arm_disassembly records;
+                disassembler.decode(range, records);
+                if (!same_records(records, expected)) failures++;
+                if (disassemble2array(image) != expected_lines) failures++;
+            }
+        });
+    }
+    for (auto& worker : workers) worker.join();
+
+    std::cout << threads << " threads x " << rounds << " rounds: "
+        << failures << " mismatched decodes\n";
+    return failures == 0 ? 0 : 1;
+}
+
+
+/**
+ * A relocatable ARM object with the given number of 4-byte code sections,
+ * each with its STT_SECTION symbol, and function symbols spread across
+ * them round-robin, named f0, f1, ...
+ */
+static std::string synthetic_object(size_t symbols, size_t sections) {
+    const char section_names[] = "\0.shstrtab\0.strtab\0.symtab\0.text";
+    std::string strtab(1, '\0');
+    std::vector<Elf32_Sym> symtab(1 + sections + symbols);
+    memset(symtab.data(), 0, symtab.size() * sizeof(Elf32_Sym));
+    for (size_t i = 0; i < sections; i++) {
+        symtab[1 + i].st_info = STT_SECTION;
+        symtab[1 + i].st_shndx = 4 + i;
+    }
+    for (size_t i = 0; i < symbols; i++) {
+        auto& symbol = symtab[1 + sections + i];
+        symbol.st_name = strtab.size();
+        symbol.st_info = (STB_GLOBAL << 4) | STT_FUNC;
+        symbol.st_shndx = 4 + i % sections;
+        symbol.st_size = 4;
+        strtab += "f" + std::to_string(i);
+        strtab.push_back('\0');
+    }
+
+    Elf32_Ehdr header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.e_ident, "\x7f" "ELF", 4);
+    header.e_ident[EI_CLASS] = ELFCLASS32;
+    header.e_ident[EI_DATA] = ELFDATA2LSB;
+    header.e_ident[EI_VERSION] = EV_CURRENT;
+    header.e_type = ET_REL;
+    header.e_machine = EM_ARM;
+    header.e_version = EV_CURRENT;
+    header.e_ehsize = sizeof(Elf32_Ehdr);
+    header.e_shentsize = sizeof(Elf32_Shdr);
+    header.e_shnum = 4 + sections;
+    header.e_shstrndx = 1;
+
+    std::string image((const char*)&header, sizeof(header));
+    std::vector<Elf32_Shdr> headers(header.e_shnum);
+    memset(headers.data(), 0, headers.size() * sizeof(Elf32_Shdr));
+    auto place = [&](size_t index, Elf32_Word name, Elf32_Word type, const void* data, size_t size) {
+        headers[index].sh_name = name;
+        headers[index].sh_type = type;
+        headers[index].sh_offset = image.size();
+        headers[index].sh_size = size;
+        image.append((const char*)data, size);
+    };
+    place(1, 1, SHT_STRTAB, section_names, sizeof(section_names));
+    place(2, 11, SHT_STRTAB, strtab.data(), strtab.size());
+    place(3, 19, SHT_SYMTAB, symtab.data(), symtab.size() * sizeof(Elf32_Sym));
+    headers[3].sh_link = 2;
+    headers[3].sh_entsize = sizeof(Elf32_Sym);
+    const uint32_t bx_lr = 0xe12fff1e;
+    for (size_t i = 0; i < sections; i++)
+        place(4 + i, 27, SHT_PROGBITS, &bx_lr, 4);
+
+    uint32_t offset = image.size();
+    memcpy(&image[offsetof(Elf32_Ehdr, e_shoff)], &offset, 4);
+    image.append((const char*)headers.data(), headers.size() * sizeof(Elf32_Shdr));
+    return image;
+}
+
+
+// time to parse a synthetic object, best of a few runs
+static void bench_elf(size_t symbols, size_t sections) {
+    std::string image = synthetic_object(symbols, sections);
+    size_t parsed = 0;
+    auto t = best_of(3, [&]() {
+        struct object obj = ELF_parse(image.data(), image.size());
+        parsed = obj.sections.size();
+        return obj.symbols.size();
+    });
+    std::cout << std::setw(9) << symbols << " symbols " << std::setw(7) << parsed
+        << " sections: " << std::fixed << std::setprecision(2)
+        << t.nanoseconds / 1e6 << " ms, " << std::setprecision(3)
+        << (double)t.allocations / t.records << " allocs/symbol\n";
+}
+
+
+// the object format has no extended section numbering, so the sweep
+// stops short of SHN_LORESERVE rather than at 100k sections
+static void sweep_sections() {
+    const size_t counts[] = { 10, 100, 1000, 10000, SHN_LORESERVE - 4 };
+    for (size_t sections : counts)
+        bench_elf(10 * sections, sections);
+}
+
+
+/**
+ * ns per mnemonic through instruction_t::classify(), over every command_t
+ * stem with and without an S flag and each condition, in upper and lower
+ * case; only the spellings it accepts are kept.
+ */
+static int bench_mnemonics(int runs) {
+    const char* stems[] = {
+        "adc", "add", "and", "asr", "b", "bfc", "bfi", "bic", "bkpt",
+        "bl", "blx", "bx", "cbz", "cbnz", "clz", "cmp", "cmn", "eor", "lsl", "lsr",
+        "mla", "mls", "mov", "movw", "movt", "mul", "mvn", "nop", "orr", "pop", "push",
+        "ror", "rsb", "rsc", "sbc", "sbfx", "sdiv", "sub", "teq", "tst", "ubfx",
+        "udiv", "umaal", "umlal", "umull", "uxtb", "uxth",
+        "ldr", "ldrb", "ldrh", "ldrsb", "ldrsh", "ldrd", "str", "strb", "strh", "strd",
+        "ldm", "ldmia", "ldmib", "ldmda", "ldmdb", "stm", "stmia", "stmib", "stmda", "stmdb"
+    };
+    const char* conditions[] = { "", "eq", "ne", "cs", "cc", "mi", "pl", "vs",
+        "vc", "hi", "ls", "ge", "lt", "gt", "le", "al" };
+
+    std::vector<std::string> mnemonics;
+    for (const char* stem : stems) {
+        for (const char* set : { "", "s" }) {
+            for (const char* condition : conditions) {
+                for (bool upper : { false, true }) {
+                    std::string mnemonic = std::string(stem) + set + condition;
+                    if (upper) std::transform(mnemonic.begin(), mnemonic.end(), mnemonic.begin(), ::toupper);
+                    if (arm::instruction_t::classify(mnemonic).command == arm::command_t::UNKNOWN)
+                        continue;
+                    mnemonics.push_back(mnemonic);
+                }
+            }
+        }
+    }
+
+    const int repeats = 1000;
+    size_t checksum = 0;
+    auto t = best_of(runs, [&]() {
+        for (int r = 0; r < repeats; r++) {
+            for (const auto& mnemonic : mnemonics) {
+                auto parts = arm::instruction_t::classify(mnemonic);
+                checksum += (size_t)parts.command + (size_t)parts.condition + parts.set + parts.variant;
+            }
+        }
+        return mnemonics.size() * repeats;
+    });
+    report("classify", t);
+    std::cout << "  " << mnemonics.size() << " spellings (checksum " << checksum << ")\n";
+    return 0;
+}
+
+
+static void print_usage(const char* program) {
+    std::cout << "Usage: " << program << " <command> [arguments]\n";
+    std::cout << "Commands:\n";
+    std::cout << "\tdecode [a|t] [file]\tdecode throughput and allocations; without a file,\n"
+                 "\t\t\t\ta synthetic 1 MB image in the given mode (default a);\n"
+                 "\t\t\t\tthen opcode dispatch against a linear table scan\n";
+    std::cout << "\tthumb16 [file]\t\tThumb decode with the 16-bit table on and off; without\n"
+                 "\t\t\t\ta file, a synthetic 1 MB image of 16-bit instructions only\n";
+    std::cout << "\tthreads [n]\t\tdecode a mixed ARM/Thumb image on n threads (default 8)\n"
+                 "\t\t\t\tand check every result is byte-identical\n";
+    std::cout << "\telf [symbols] [sections]\tload time of a synthetic object (default 1M symbols,\n"
+                 "\t\t\t\t10 sections)\n";
+    std::cout << "\tsections\t\t\tload time as the section count grows from 10 to 65k\n";
+    std::cout << "\tmnemonics\t\tinstruction classification time per mnemonic\n";
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    std::string command = argv[1];
+    if (command == "decode") {
+        char mode = (argc > 2 && argv[2][0] == 't') ? 't' : 'a';
+        std::string image;
+        if (argc > 3 && !read_file(argv[3], image)) {
+            std::cerr << "could not open file " << argv[3] << std::endl;
+            return 1;
+        }
+        if (argc <= 3) image = synthetic_image(1 << 20, mode == 't');
+        int status = bench_decode(image, mode, 5);
+        return status | compare_lookups(image, mode, 5, "records, linear scan", 0);
+    }
+
+    if (command == "thumb16") {
+        std::string image;
+        if (argc > 2 && !read_file(argv[2], image)) {
+            std::cerr << "could not open file " << argv[2] << std::endl;
+            return 1;
+        }
+        if (argc <= 2) image = synthetic_thumb16(1 << 20);
+        return compare_lookups(image, 't', 5, "records, thumb16 scan", ARM_DISPATCH_TABLES);
+    }
+
+    if (command == "threads") {
+        unsigned threads = (argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 8;
+        return stress_threads(std::max(threads, 1u), 4);
+    }
+
+    if (command == "elf") {
+        size_t symbols = (argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 1000000;
+        size_t sections = (argc > 3) ? std::strtoul(argv[3], nullptr, 10) : 10;
+        bench_elf(symbols, std::min<size_t>(std::max<size_t>(sections, 1), SHN_LORESERVE - 4));
+        return 0;
+    }
+
+    if (command == "sections") {
+        sweep_sections();
+        return 0;
+    }
+
+    if (command == "mnemonics")
+        return bench_mnemonics(5);
+
+    print_usage(argv[0]);
+    return 1;
+}
@@ -5,10 +5,150 @@
 #ifndef ARM_DISASSEMBLER_H
 #define ARM_DISASSEMBLER_H
 
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
-std::string disassemble(std::string binary);
-std::vector<std::string> disassemble2array(std::string binary);
+#define ARM_INSN_THUMB      0x01 /* decoded as a Thumb instruction */
+#define ARM_INSN_HAS_TARGET 0x02 /* target holds a branch destination */
+#define ARM_INSN_DATA       0x04 /* a $d word, halfword or byte, not decoded */
+
+/**
+ * One decoded instruction, as reported by libopcodes. The rendered text is
+ * not stored inline; text/text_size locate it in arm_disassembly::text, and
+ * the mnemonic, operand and comment parts are offsets within that line.
+ */
+struct arm_instruction {
+    uint32_t address;
+    uint32_t word;          /* raw encoding; Thumb-32 as (hw1 << 16) | hw2 */
+    uint32_t target;        /* valid if ARM_INSN_HAS_TARGET */
+    uint32_t opcode;        /* opcode table entry id, 0 if unknown */
+    uint32_t text;          /* offset of the line in arm_disassembly::text */
+    uint16_t text_size;
+    uint16_t mnemonic_size; /* line[0, mnemonic_size) */
+    uint16_t comment;       /* line[comment, text_size), starts at "\t;" */
+    uint8_t  size;          /* bytes consumed */
+    uint8_t  condition;     /* 0x0-0xd, 0xe = always */
+    uint8_t  type;          /* enum dis_insn_type */
+    uint8_t  flags;         /* ARM_INSN_* */
+};
+
+/**
+ * Start of a run of ARM code ('a'), Thumb code ('t') or data ('d'), as
+ * marked by the $a, $t and $d mapping symbols of an ARM ELF object.
+ */
+struct arm_mapping {
+    uint32_t address;
+    char type;
+};
+
+/* 'a', 't' or 'd' for a mapping symbol name ("$t", "$t.foo"), else 0 */
+char arm_mapping_type(std::string_view name);
+
+struct arm_disassembly {
+    std::vector<arm_instruction> instructions;
+    std::string text;
+
+    /* views into text; invalidated when the disassembly is destroyed */
+    std::string_view line(size_t index) const;
+    std::string_view mnemonic(size_t index) const;
+    std::string_view operands(size_t index) const;
+    std::string_view comment(size_t index) const;
+
+    std::vector<std::string> lines(size_t first, size_t last) const;
+
+    /**
+     * Index of the instruction in [first, last) whose bytes cover address,
+     * or last if there is none. The range must be in address order, as
+     * the records of one span are.
+     */
+    size_t find(uint32_t address, size_t first, size_t last) const;
+    size_t find(uint32_t address) const
+    { return find(address, 0, instructions.size()); }
+};
+
+/**
+ * Long-lived libopcodes context. The target setup is done once on
+ * construction; decode() then works directly on caller-owned memory.
+ */
+class arm_disassembler {
+public:
+    /**
+     * Bytes to decode. Without mapping symbols everything is decoded as
+     * ARM code; with them, each run is decoded in the mode of the last
+     * $a or $t at or before its start, and $d runs are emitted as .word
+     * (.short, .byte) records without going through libopcodes. The
+     * mapping list is sorted by address, may cover more than the span and
+     * is not copied.
+     */
+    struct span {
+        const void* data;
+        size_t size;
+        uint32_t vma; /* address of data[0] */
+        const arm_mapping* mapping = nullptr;
+        size_t mapping_size = 0;
+    };
+
+    /* decode() activity, summed over every disassembler in the process */
+    struct statistics {
+        uint64_t instructions; /* records produced */
+        uint64_t nanoseconds;  /* spent in decode() */
+        uint64_t memo_hits;    /* records copied from the memo */
+        uint64_t memo_misses;  /* memo lookups that had to decode */
+    };
+
+    arm_disassembler();
+    ~arm_disassembler();
+    arm_disassembler(const arm_disassembler&) = delete;
+    arm_disassembler& operator=(const arm_disassembler&) = delete;
+
+    /**
+     * Remember the record and text of each instruction word decoded, and
+     * copy them for the next occurrence of the same word in the same mode
+     * instead of running libopcodes again. An address printed by the
+     * instruction (a branch or literal target) is rewritten for the new
+     * location. Words inside IT and VPT blocks are always decoded. The
+     * memo is a fixed-size table that keeps the latest word per slot; it
+     * is off by default, and is dropped when turned off.
+     */
+    void memoize(bool enabled);
+
+    static statistics totals();
+
+    arm_disassembly decode(
+        const void* data,
+        size_t size,
+        uint32_t vma = 0,
+        bool with_text = true);
+
+    /* appends the records of one span to an existing disassembly */
+    void decode(
+        const span& range,
+        arm_disassembly& result,
+        bool with_text = true);
+
+    /**
+     * Decode many ranges into one disassembly. The records of spans[k] are
+     * instructions[first[k], first[k + 1]); first has spans.size() + 1
+     * entries.
+     */
+    arm_disassembly decode(
+        const std::vector<span>& spans,
+        std::vector<size_t>& first,
+        bool with_text = true);
+
+private:
+    struct context;
+    std::unique_ptr<context> m_context;
+};
+
+arm_disassembly disassemble_records(
+    std::string_view binary,
+    bool with_text = true);
+
+std::string disassemble(std::string_view binary);
+std::vector<std::string> disassemble2array(std::string_view binary);
 
 #endif
@@ -2,6 +2,8 @@
  * Created by TekuConcept on March 10, 2020
  */
 
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <iomanip>
 #include <fstream>
@@ -21,18 +23,62 @@ void print_usage(const char* program)
 
 
 
-int translate(std::istream& in, std::ostream& out) {
-    std::string raw = std::string(
-        std::istreambuf_iterator<char>(in),
-        std::istreambuf_iterator<char>());
+/**
+ * The input is decoded a chunk at a time so memory stays bounded no matter
+ * how large the dump is. Each read carries chunk_overlap extra bytes that
+ * are only decoded, not printed; an instruction that would run past the
+ * end of the chunk is decoded again from the start of the next one.
+ */
+static const size_t chunk_size    = 1 << 20;
+static const size_t chunk_overlap = 4; /* longest ARM or Thumb-2 encoding */
 
-    auto asm_strings = disassemble2array(raw);
 
-    unsigned int pc = 0;
-    for (const auto& line : asm_strings) {
-        out << std::setw(4) << std::hex << pc << ": ";
-        out << line << "\n";
-        pc += 4;
+int translate(std::istream& in, std::ostream& out) {
+    arm_disassembler disassembler;
+    arm_disassembly records;
+    std::vector<char> buffer(chunk_size + chunk_overlap);
+    size_t carried = 0; /* bytes left at the front of buffer from the last read */
+    uint32_t vma = 0;   /* address of buffer[0] */
+
+    out << std::hex;
+    for (;;) {
+        in.read(buffer.data() + carried, buffer.size() - carried);
+        size_t size = carried + in.gcount();
+        if (size == 0) break;
+        bool last = !in;
+        size_t limit = last ? size : size - chunk_overlap;
+
+        records.instructions.clear();
+        records.text.clear();
+        disassembler.decode({ buffer.data(), size, vma }, records);
+
+        size_t consumed = 0;
+        for (size_t k = 0; k < records.instructions.size(); k++) {
+            const auto& instruction = records.instructions[k];
+            if (instruction.address - vma >= limit) break;
+            out << std::setw(4) << instruction.address << ": ";
+            out << records.line(k) << "\n";
+            consumed = instruction.address - vma + instruction.size;
+        }
+
+        // a final partial word is too short to decode; keep it as data
+        if (last) {
+            for (size_t k = consumed; k < size; k++) {
+                out << std::setw(4) << vma + k << ": .byte\t0x" << std::setfill('0')
+                    << std::setw(2) << (unsigned)(uint8_t)buffer[k] << std::setfill(' ') << "\n";
+            }
+            break;
+        }
+
+        // the decoder only stops early on bytes it cannot make sense of
+        if (consumed < limit) {
+            std::cerr << "Stopped decoding at 0x" << std::hex << vma + consumed
+                << std::dec << "\n";
+            break;
+        }
+        carried = size - consumed;
+        memmove(buffer.data(), buffer.data() + consumed, carried);
+        vma += consumed;
     }
     out << std::dec;
 
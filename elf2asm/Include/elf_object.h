@@ -8,6 +8,7 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <string_view>
 
 class elf_object {
 public:
@@ -180,8 +181,9 @@ public:
     };
 
     struct section_t;
+    // names are views into the string table sections' raw_data
     struct symbol_t {
-        std::string name;
+        std::string_view name;
         unsigned int value;
         unsigned int size;
         sym_bind_t bind;
@@ -199,7 +201,7 @@ public:
     };
 
     struct section_t {
-        std::string name;
+        std::string_view name;
         std::string raw_data;
         section_type_t type;
         section_t* link;
@@ -213,6 +215,8 @@ public:
         unsigned int entry_size;
         
         std::vector<size_t> entry_indices;
+        // relocations applying to this section, ordered by offset
+        std::vector<size_t> relocation_indices;
     };
 
     static elf_object parse(std::istream& stream);
@@ -221,6 +225,11 @@ public:
     static std::string section_flags_string(unsigned int flags);
 
     elf_object() = default;
+    elf_object(elf_object&&) = default;
+    elf_object& operator=(elf_object&&) = default;
+    // sections, symbols and relocations point into each other
+    elf_object(const elf_object&) = delete;
+    elf_object& operator=(const elf_object&) = delete;
 
     inline const std::vector<section_t>& sections() const
     { return m_sections; }
@@ -3,119 +3,689 @@
  */
 
 #include "arm_disassembler.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
 #include <cstdio>
 #include <cstring>
-#include <sstream>
 #include "libopcodes_config.h"
 #include "dis-asm.h"
 
 
+/**
+ * Output sink for libopcodes. The buffer is kept resized to its full
+ * capacity and `size` tracks how much of it is in use, so each fragment is
+ * formatted straight into place and only a full buffer causes a reallocation.
+ */
+struct text_arena {
+    std::string* buffer;
+    size_t size;
+};
+
+
 static int
 disassemble_fprintf(
     void* stream,
     const char* fmt,
     ...)
 {
-    std::stringstream& os = *(std::stringstream*)stream;
-    char* buffer;
+    text_arena& arena = *(text_arena*)stream;
+    std::string& buffer = *arena.buffer;
+    if (buffer.size() < buffer.capacity())
+        buffer.resize(buffer.capacity());
+
     va_list arg;
     va_start(arg, fmt);
-    vasprintf(&buffer, fmt, arg);
-    std::string line(buffer);
-    os << line;
-    free(buffer);
+    size_t room = buffer.size() - arena.size;
+    int size = vsnprintf(&buffer[0] + arena.size, room, fmt, arg);
     va_end(arg);
-    return 0;
+    if (size <= 0) return size;
+
+    if ((size_t)size >= room) {
+        buffer.resize(std::max(2 * buffer.size(), arena.size + size + 1));
+        va_start(arg, fmt);
+        vsnprintf(&buffer[arena.size], size + 1, fmt, arg);
+        va_end(arg);
+    }
+    arena.size += size;
+    return size;
 }
 
 
-std::string
-disassemble(std::string binary)
+static void
+arena_append(
+    text_arena& arena,
+    const char* text,
+    size_t size)
 {
-    std::stringstream ss;
+    std::string& buffer = *arena.buffer;
+    if (buffer.size() < arena.size + size)
+        buffer.resize(std::max(2 * buffer.size(), arena.size + size + 1));
+    memcpy(&buffer[arena.size], text, size);
+    arena.size += size;
+}
 
-    // STEP 1
-    struct disassemble_info disasm_info;
-    memset(&disasm_info, 0, sizeof(disassemble_info));
-    init_disassemble_info(
-        &disasm_info, &ss, (fprintf_ftype)disassemble_fprintf);
-    disasm_info.arch = bfd_arch_arm;
-    disasm_info.mach = bfd_mach_arm_unknown;
-    disasm_info.read_memory_func = buffer_read_memory;
-    disasm_info.buffer = (unsigned char*)&binary[0];
-    disasm_info.buffer_vma = 0;
-    disasm_info.buffer_length = binary.size();
-    disassemble_init_for_target(&disasm_info);
 
-    // STEP 2
+static int
+disassemble_discard(
+    void* stream,
+    const char* fmt,
+    ...)
+{ return 0; }
+
+
+static void
+describe_line(
+    const std::string& text,
+    arm_instruction& instruction)
+{
+    const char* line = &text[instruction.text];
+    size_t size = instruction.text_size;
+
+    const char* tab = (const char*)memchr(line, '\t', size);
+    instruction.mnemonic_size = tab ? (tab - line) : size;
+    instruction.comment = size;
+    for (size_t i = instruction.mnemonic_size; i + 1 < size; i++) {
+        if (line[i] == '\t' && line[i + 1] == ';') {
+            instruction.comment = i;
+            break;
+        }
+    }
+}
+
+
+/**
+ * Fills in a record for the data at address without going through
+ * libopcodes, sized and printed the way it prints $d runs: a word at a
+ * time, with halfwords and bytes to reach alignment or the end of the run.
+ * Returns the number of bytes consumed.
+ */
+static size_t
+describe_data(
+    uint32_t address,
+    const unsigned char* b,
+    size_t room,
+    text_arena* arena,
+    arm_instruction& instruction)
+{
+    size_t size = std::min<size_t>(4 - (address & 3), room);
+    if (size == 3) size = (address & 1) ? 1 : 2;
+
+    instruction.address   = address;
+    instruction.size      = size;
+    instruction.opcode    = 0;
+    instruction.condition = 0xe;
+    instruction.type      = dis_noninsn;
+    instruction.flags     = ARM_INSN_DATA;
+    instruction.target    = 0;
+    if (size == 4) {
+        instruction.word = (b[3] << 24) | (b[2] << 16) | (b[1] << 8) | b[0];
+        if (arena) disassemble_fprintf(arena, ".word\t0x%08lx", (unsigned long)instruction.word);
+    }
+    else if (size == 2) {
+        instruction.word = (b[1] << 8) | b[0];
+        if (arena) disassemble_fprintf(arena, ".short\t0x%04lx", (unsigned long)instruction.word);
+    }
+    else {
+        instruction.word = b[0];
+        if (arena) disassemble_fprintf(arena, ".byte\t0x%02lx", (unsigned long)instruction.word);
+    }
+    return size;
+}
+
+
+static std::atomic<uint64_t> total_instructions;
+static std::atomic<uint64_t> total_nanoseconds;
+static std::atomic<uint64_t> total_memo_hits;
+static std::atomic<uint64_t> total_memo_misses;
+
+
+/**
+ * A memoized instruction: the record and text libopcodes produced for one
+ * word, with the target and any printed address kept relative to the pc.
+ * Both are only valid at the same pc & 3, as Thumb literal addressing
+ * aligns the pc down.
+ */
+struct memo_entry {
+    uint64_t key;           /* memo_key(); 0 for an empty slot */
+    int64_t  target;        /* target - pc, if ARM_INSN_HAS_TARGET */
+    int64_t  address;       /* printed address - pc, if address_at */
+    uint32_t opcode;
+    uint16_t mnemonic_size;
+    uint16_t comment;
+    uint8_t  size;
+    uint8_t  condition;
+    uint8_t  type;
+    uint8_t  flags;
+    uint8_t  text_size;
+    uint8_t  address_at;    /* offset of the address digits, 0 if none */
+    uint8_t  alignment;     /* pc & 3 */
+    char     text[53];
+};
+
+#define MEMO_BITS 13
+#define ADDRESS_DIGITS 16 /* generic_print_address: "0x" and a full bfd_vma */
+
+
+/**
+ * The memo key of the instruction at b: mode, encoding and whether text is
+ * wanted. False if the instruction would run past the end of the span.
+ */
+static bool
+memo_key(
+    bool thumb,
+    const unsigned char* b,
+    size_t room,
+    bool with_text,
+    uint64_t& key)
+{
+    uint32_t word;
+    if (!thumb) {
+        if (room < 4) return false;
+        word = (b[3] << 24) | (b[2] << 16) | (b[1] << 8) | b[0];
+    }
+    else {
+        if (room < 2) return false;
+        word = (b[1] << 8) | b[0];
+        if ((word & 0xF800) >= 0xE800) { /* 32-bit Thumb */
+            if (room < 4) return false;
+            word = (word << 16) | (b[3] << 8) | b[2];
+        }
+    }
+    key = (1ULL << 63) | ((uint64_t)with_text << 33) |
+        ((uint64_t)thumb << 32) | word;
+    return true;
+}
+
+
+struct arm_disassembler::context {
+    struct disassemble_info info;
     disassembler_ftype disasm;
-    disasm = disassembler(
-        disasm_info.arch,
-        /*big-endian=*/false,
-        disasm_info.mach,
-        /*abfd=*/NULL
-    );
+    text_arena arena;
+    const arm_mapping* mapping; /* of the span being decoded */
+    const arm_mapping* mapping_end;
 
-    if (!disasm) {
-        // std::cout << "No disassembler!" << std::endl;
-        perror("No Disassembler\n");
-        return "";
+    std::vector<memo_entry> memo; /* empty when not memoizing */
+    unsigned addresses;           /* printed by the last instruction */
+    size_t address_at;            /* arena offset of the last one */
+    bfd_vma address;
+
+    memo_entry& slot(uint64_t key)
+    { return memo[(key * 0x9E3779B97F4A7C15ULL) >> (64 - MEMO_BITS)]; }
+
+    bool recall(uint64_t key, uint32_t address, arm_instruction& instruction);
+    void remember(uint64_t key, const arm_instruction& instruction);
+
+    static int mapping_run(bfd_vma pc, bfd_vma* start, bfd_vma* end,
+        disassemble_info* info);
+    static void print_address(bfd_vma address, disassemble_info* info);
+};
+
+
+// fills in the memoized instruction for key at address, if there is one
+// and its target and printed address can be moved there
+bool
+arm_disassembler::context::recall(
+    uint64_t key,
+    uint32_t address,
+    arm_instruction& instruction)
+{
+    const memo_entry& entry = slot(key);
+    if (entry.key != key) return false;
+    bool relative = (entry.flags & ARM_INSN_HAS_TARGET) || entry.address_at;
+    if (relative && entry.alignment != (address & 3)) return false;
+
+    // libopcodes wraps some addresses to 32 bits and not others, so only
+    // an address that stays clear of the wrap can be moved
+    bfd_vma printed = (bfd_vma)address + entry.address;
+    if (entry.address_at && printed > 0xffffffff) return false;
+
+    instruction.address       = address;
+    instruction.word          = (uint32_t)key;
+    instruction.target        = 0;
+    instruction.opcode        = entry.opcode;
+    instruction.size          = entry.size;
+    instruction.condition     = entry.condition;
+    instruction.type          = entry.type;
+    instruction.flags         = entry.flags;
+    instruction.text_size     = entry.text_size;
+    instruction.mnemonic_size = entry.mnemonic_size;
+    instruction.comment       = entry.comment;
+    if (entry.flags & ARM_INSN_HAS_TARGET)
+        instruction.target = address + entry.target;
+
+    arena_append(arena, entry.text, entry.text_size);
+    if (entry.address_at) {
+        char digits[ADDRESS_DIGITS + 1];
+        snprintf(digits, sizeof(digits), "%016llx", (unsigned long long)printed);
+        memcpy(&(*arena.buffer)[instruction.text + entry.address_at],
+            digits, ADDRESS_DIGITS);
     }
+    return true;
+}
 
-    // STEP 3
-    size_t pc = 0; // program counter
-    while (pc < disasm_info.buffer_length) {
-        size_t bytes_consumed = disasm(pc, &disasm_info);
-        pc += bytes_consumed;
-        ss << "\n";
+
+// keeps a freshly decoded instruction, unless its text is too long for
+// a slot or holds addresses that could not be rewritten
+void
+arm_disassembler::context::remember(
+    uint64_t key,
+    const arm_instruction& instruction)
+{
+    memo_entry entry;
+    if (addresses > 1 || instruction.text_size > sizeof(entry.text)) return;
+
+    entry.key           = key;
+    entry.target        = (int32_t)(instruction.target - instruction.address);
+    entry.address       = 0;
+    entry.opcode        = instruction.opcode;
+    entry.mnemonic_size = instruction.mnemonic_size;
+    entry.comment       = instruction.comment;
+    entry.size          = instruction.size;
+    entry.condition     = instruction.condition;
+    entry.type          = instruction.type;
+    entry.flags         = instruction.flags;
+    entry.text_size     = instruction.text_size;
+    entry.address_at    = 0;
+    entry.alignment     = instruction.address & 3;
+    if (addresses == 1 && instruction.text_size != 0) {
+        size_t at = address_at - instruction.text;
+        if (at == 0 || at + ADDRESS_DIGITS > instruction.text_size) return;
+        if (address > 0xffffffff) return;
+        entry.address_at = at;
+        entry.address = address - instruction.address;
     }
+    memcpy(entry.text, &(*arena.buffer)[instruction.text], instruction.text_size);
+    slot(key) = entry;
+}
+
 
-    return ss.str();
+// notes where the address went, so a memoized copy can rewrite it
+void
+arm_disassembler::context::print_address(
+    bfd_vma address,
+    disassemble_info* info)
+{
+    context& self = *(context*)info->application_data;
+    size_t start = self.arena.size;
+    generic_print_address(address, info);
+    self.addresses++;
+    self.address_at = start + 2;
+    self.address = address;
+    if (self.arena.size - start != 2 + ADDRESS_DIGITS && info->fprintf_func !=
+        (fprintf_ftype)disassemble_discard)
+        self.addresses++; // not in a form that can be rewritten
 }
 
 
-std::vector<std::string>
-disassemble2array(std::string binary)
+// libopcodes asks for the run holding pc only when pc leaves the last one
+int
+arm_disassembler::context::mapping_run(
+    bfd_vma pc,
+    bfd_vma* start,
+    bfd_vma* end,
+    disassemble_info* info)
+{
+    const context& self = *(const context*)info->application_data;
+    auto next = std::upper_bound(self.mapping, self.mapping_end, pc,
+        [](bfd_vma address, const arm_mapping& m) { return address < m.address; });
+    *start = (next == self.mapping) ? 0 : next[-1].address;
+    *end = (next == self.mapping_end) ? ~(bfd_vma)0 : next->address;
+    return (next == self.mapping) ? 0 : next[-1].type;
+}
+
+
+arm_disassembler::arm_disassembler()
+: m_context(new context())
 {
-    std::vector<std::string> instructions;
-    std::stringstream ss;
+    auto& disasm_info = m_context->info;
 
     // STEP 1
-    struct disassemble_info disasm_info;
     memset(&disasm_info, 0, sizeof(disassemble_info));
-    init_disassemble_info(
-        &disasm_info, &ss, (fprintf_ftype)disassemble_fprintf);
+    init_disassemble_info(&disasm_info, &m_context->arena,
+        (fprintf_ftype)disassemble_fprintf);
     disasm_info.arch = bfd_arch_arm;
     disasm_info.mach = bfd_mach_arm_unknown;
     disasm_info.read_memory_func = buffer_read_memory;
-    disasm_info.buffer = (unsigned char*)&binary[0];
-    disasm_info.buffer_vma = 0;
-    disasm_info.buffer_length = binary.size();
     disassemble_init_for_target(&disasm_info);
 
+    // the backward IT scan stops at symbols; only mapping symbols are
+    // known to be on instruction boundaries outside an IT block
+    disasm_info.application_data = m_context.get();
+    disasm_info.print_address_func = context::print_address;
+    disasm_info.symbol_at_address_func = [](bfd_vma address, disassemble_info* info) -> int {
+        const context& self = *(const context*)info->application_data;
+        auto it = std::lower_bound(self.mapping, self.mapping_end, address,
+            [](const arm_mapping& m, bfd_vma address) { return m.address < address; });
+        return it != self.mapping_end && it->address == address;
+    };
+
     // STEP 2
-    disassembler_ftype disasm;
-    disasm = disassembler(
+    m_context->disasm = disassembler(
         disasm_info.arch,
         /*big-endian=*/false,
         disasm_info.mach,
         /*abfd=*/NULL
     );
 
-    if (!disasm) {
-        // std::cout << "No disassembler!" << std::endl;
+    if (!m_context->disasm)
         perror("No Disassembler\n");
-        return instructions;
+    else // sets up the decoder state now, not in the first decode()
+        arm_set_mapping_func(&disasm_info, context::mapping_run);
+}
+
+
+arm_disassembler::~arm_disassembler()
+{ disassemble_free_target(&m_context->info); }
+
+
+void
+arm_disassembler::memoize(bool enabled)
+{
+    if (!enabled) std::vector<memo_entry>().swap(m_context->memo);
+    else if (m_context->memo.empty())
+        m_context->memo.assign(1 << MEMO_BITS, memo_entry());
+}
+
+
+arm_disassembler::statistics
+arm_disassembler::totals()
+{
+    return {
+        total_instructions.load(),
+        total_nanoseconds.load(),
+        total_memo_hits.load(),
+        total_memo_misses.load() };
+}
+
+
+arm_disassembly
+arm_disassembler::decode(
+    const void* data,
+    size_t size,
+    uint32_t vma,
+    bool with_text)
+{
+    arm_disassembly result;
+    if (with_text) result.text.reserve(size * 8 + 64);
+    result.instructions.reserve(size / 4);
+    decode(span{ data, size, vma }, result, with_text);
+    return result;
+}
+
+
+arm_disassembly
+arm_disassembler::decode(
+    const std::vector<span>& spans,
+    std::vector<size_t>& first,
+    bool with_text)
+{
+    size_t total = 0;
+    for (const auto& range : spans) total += range.size;
+
+    arm_disassembly result;
+    if (with_text) result.text.reserve(total * 8 + 64);
+    result.instructions.reserve(total / 4);
+
+    first.clear();
+    first.reserve(spans.size() + 1);
+    for (const auto& range : spans) {
+        first.push_back(result.instructions.size());
+        decode(range, result, with_text);
+    }
+    first.push_back(result.instructions.size());
+    return result;
+}
+
+
+void
+arm_disassembler::decode(
+    const span& range,
+    arm_disassembly& result,
+    bool with_text)
+{
+    auto& disasm_info = m_context->info;
+    auto& arena = m_context->arena;
+    if (!m_context->disasm) return;
+    auto started = std::chrono::steady_clock::now();
+    size_t count = result.instructions.size();
+    uint64_t hits = 0, misses = 0;
+
+    const unsigned char* data = (const unsigned char*)range.data;
+    disasm_info.fprintf_func = with_text ?
+        (fprintf_ftype)disassemble_fprintf :
+        (fprintf_ftype)disassemble_discard;
+    disasm_info.buffer = (unsigned char*)data;
+    disasm_info.buffer_vma = range.vma;
+    disasm_info.buffer_length = range.size;
+    arena.buffer = &result.text;
+    arena.size = result.text.size();
+
+    // libopcodes picks ARM or Thumb from the span's mapping symbols itself;
+    // data runs are still walked here so they never reach it
+    const arm_mapping* map = range.mapping;
+    const arm_mapping* map_end = range.mapping + range.mapping_size;
+    const arm_mapping* next = std::upper_bound(map, map_end, range.vma,
+        [](uint32_t address, const arm_mapping& m) { return address < m.address; });
+    m_context->mapping = map;
+    m_context->mapping_end = map_end;
+    arm_set_mapping_func(&disasm_info, context::mapping_run);
+    bool is_data = (next != map && next[-1].type == 'd');
+    bool thumb = (next != map && next[-1].type == 't');
+    // the memo is only used where the IT and VPT state is known to be
+    // clear: from a mapping symbol on, for as long as libopcodes agrees
+    bool predicated = true;
+    if (next != map && next[-1].address == range.vma) {
+        arm_reset_ifthen_state(&disasm_info, range.vma);
+        predicated = false;
     }
 
     // STEP 3
-    size_t pc = 0; // program counter
-    while (pc < disasm_info.buffer_length) {
-        size_t bytes_consumed = disasm(pc, &disasm_info);
-        pc += bytes_consumed;
-        instructions.push_back(ss.str());
-        ss.str("");
+    size_t offset = 0;
+    while (offset < range.size) {
+        arm_instruction instruction;
+        instruction.text = arena.size;
+
+        // a span is decoded in order, so the IT state is carried forward
+        // and only needs clearing where a mapping symbol starts a new run
+        for (; next != map_end && next->address <= range.vma + offset; next++) {
+            is_data = (next->type == 'd');
+            if (is_data) continue;
+            thumb = (next->type == 't');
+            arm_reset_ifthen_state(&disasm_info, range.vma + offset);
+            predicated = false;
+        }
+
+        if (is_data) {
+            size_t end = range.size;
+            if (next != map_end && next->address - range.vma < end)
+                end = next->address - range.vma;
+            size_t size = describe_data(range.vma + offset, &data[offset],
+                end - offset, with_text ? &arena : NULL, instruction);
+            instruction.text_size = arena.size - instruction.text;
+            describe_line(result.text, instruction);
+            result.instructions.push_back(instruction);
+            offset += size;
+            continue;
+        }
+
+        uint64_t key = 0;
+        if (!m_context->memo.empty() && !predicated &&
+            memo_key(thumb, &data[offset], range.size - offset, with_text, key)) {
+            if (m_context->recall(key, range.vma + offset, instruction)) {
+                result.instructions.push_back(instruction);
+                offset += instruction.size;
+                if (thumb) arm_reset_ifthen_state(&disasm_info, range.vma + offset);
+                hits++;
+                continue;
+            }
+            misses++;
+        }
+
+        m_context->addresses = 0;
+        int bytes_consumed = m_context->disasm(
+            range.vma + offset, &disasm_info);
+        if (bytes_consumed <= 0) break;
+        predicated = arm_in_predicated_block(&disasm_info);
+
+        instruction.address   = range.vma + offset;
+        instruction.size      = bytes_consumed;
+        instruction.opcode    = disasm_info.insn_opcode;
+        instruction.condition = disasm_info.insn_cond;
+        instruction.type      = disasm_info.insn_type;
+        instruction.flags     = 0;
+        instruction.target    = 0;
+        if (disasm_info.bytes_per_chunk == 2)
+            instruction.flags |= ARM_INSN_THUMB;
+        if (disasm_info.insn_set_flags)
+            instruction.flags |= ARM_INSN_SETS_FLAGS;
+        if (disasm_info.insn_info_valid) {
+            instruction.flags |= ARM_INSN_HAS_TARGET;
+            instruction.target = disasm_info.target;
+        }
+
+        const unsigned char* b = &data[offset];
+        if (bytes_consumed == 4 && (instruction.flags & ARM_INSN_THUMB))
+            instruction.word = (b[1] << 24) | (b[0] << 16) | (b[3] << 8) | b[2];
+        else if (bytes_consumed == 4)
+            instruction.word = (b[3] << 24) | (b[2] << 16) | (b[1] << 8) | b[0];
+        else if (bytes_consumed == 2)
+            instruction.word = (b[1] << 8) | b[0];
+        else instruction.word = b[0];
+
+        instruction.text_size = arena.size - instruction.text;
+        describe_line(result.text, instruction);
+        result.instructions.push_back(instruction);
+        offset += bytes_consumed;
+        if (key != 0 && !predicated && thumb == (bool)(instruction.flags & ARM_INSN_THUMB))
+            m_context->remember(key, instruction);
     }
 
-    return instructions;
+    result.text.resize(arena.size);
+    arena.buffer = NULL;
+
+    total_instructions += result.instructions.size() - count;
+    total_nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - started).count();
+    total_memo_hits += hits;
+    total_memo_misses += misses;
+}
+
+
+arm_disassembly
+disassemble_records(
+    std::string_view binary,
+    bool with_text)
+{
+    arm_disassembler decoder;
+    return decoder.decode(binary.data(), binary.size(), 0, with_text);
+}
+
+
+std::string_view
+arm_disassembly::line(size_t index) const
+{
+    const auto& instruction = instructions[index];
+    return std::string_view(text).substr(
+        instruction.text, instruction.text_size);
+}
+
+
+std::string_view
+arm_disassembly::mnemonic(size_t index) const
+{
+    return line(index).substr(0, instructions[index].mnemonic_size);
+}
+
+
+std::string_view
+arm_disassembly::operands(size_t index) const
+{
+    const auto& instruction = instructions[index];
+    if (instruction.mnemonic_size >= instruction.comment) return {};
+    size_t start = instruction.mnemonic_size + 1;
+    return line(index).substr(start, instruction.comment - start);
+}
+
+
+std::string_view
+arm_disassembly::comment(size_t index) const
+{
+    return line(index).substr(instructions[index].comment);
+}
+
+
+std::vector<std::string>
+arm_disassembly::lines(
+    size_t first,
+    size_t last) const
+{
+    std::vector<std::string> result;
+    result.reserve(last - first);
+    for (size_t i = first; i < last; i++)
+        result.emplace_back(line(i));
+    return result;
+}
+
+
+size_t
+arm_disassembly::find(
+    uint32_t address,
+    size_t first,
+    size_t last) const
+{
+    auto begin = instructions.begin() + first;
+    auto end = instructions.begin() + last;
+    auto it = std::upper_bound(begin, end, address,
+        [](uint32_t address, const arm_instruction& instruction) {
+            return address < instruction.address;
+        });
+    if (it == begin) return last;
+    --it;
+    if (address - it->address >= it->size) return last;
+    return it - instructions.begin();
+}
+
+
+char
+arm_mapping_type(std::string_view name)
+{
+    if (name.size() < 2 || name[0] != '$') return 0;
+    if (name[1] != 'a' && name[1] != 't' && name[1] != 'd') return 0;
+    if (name.size() > 2 && name[2] != '.') return 0;
+    return name[1];
+}
+
+
+std::string_view
+arm_opcode_stem(uint32_t opcode)
+{
+    const char* assembler = opcode ? arm_opcode_assembler(opcode) : NULL;
+    if (assembler == NULL) return {};
+    size_t size = 0;
+    while (assembler[size] >= 'a' && assembler[size] <= 'z') size++;
+    return std::string_view(assembler, size);
+}
+
+
+std::string
+disassemble(std::string_view binary)
+{
+    auto records = disassemble_records(binary);
+    std::string result;
+    result.reserve(records.text.size() + records.instructions.size());
+    for (const auto& instruction : records.instructions) {
+        result.append(records.text, instruction.text, instruction.text_size);
+        result.push_back('\n');
+    }
+    return result;
+}
+
+
+std::vector<std::string>
+disassemble2array(std::string_view binary)
+{
+    auto records = disassemble_records(binary);
+    return records.lines(0, records.instructions.size());
 }
@@ -3,6 +3,7 @@
  */
 
 #include "elf_object.h"
+#include <algorithm>
 #include <cstring>
 #include <stdexcept>
 #include <map>
@@ -11,6 +12,20 @@
 #include <sstream>
 #include "elf.h"
 
+// NUL-terminated name at table[offset], as a view into the table
+static std::string_view
+string_at(
+    const std::string& table,
+    size_t offset)
+{
+    if (offset >= table.size())
+        throw std::runtime_error("string table index out of bounds");
+    std::string_view name(table);
+    name = name.substr(offset);
+    return name.substr(0, name.find('\0'));
+}
+
+
 elf_object
 elf_object::parse(std::istream& __stream)
 {
@@ -139,7 +154,7 @@ elf_object::parse(std::istream& __stream)
                 std::cout << offset << std::endl;
                 throw std::runtime_error("header name index out of bounds");
             }
-            obj.m_sections[i].name = std::string(&name_data[offset]);
+            obj.m_sections[i].name = string_at(name_data, offset);
         }
     }
 
@@ -190,7 +205,7 @@ elf_object::parse(std::istream& __stream)
         for (size_t i = 0; i < size; i++) {
             symbol_t symbol;
             symbol.name = (link == 0) ? "[no sym name]" :
-                std::string(&obj.m_sections[link].raw_data[symbols[i].st_name]);
+                string_at(obj.m_sections[link].raw_data, symbols[i].st_name);
             symbol.value = symbols[i].st_value;
             symbol.size  = symbols[i].st_size;
             symbol.other = symbols[i].st_other;
@@ -273,6 +288,19 @@ elf_object::parse(std::istream& __stream)
         }
     }
 
+    for (size_t i = 0; i < obj.m_relocations.size(); i++) {
+        auto* section = obj.m_relocations[i].section;
+        if (section != nullptr) section->relocation_indices.push_back(i);
+    }
+    for (auto& section : obj.m_sections) {
+        std::stable_sort(
+            section.relocation_indices.begin(),
+            section.relocation_indices.end(),
+            [&](size_t a, size_t b) {
+                return obj.m_relocations[a].offset < obj.m_relocations[b].offset;
+            });
+    }
+
     return obj;
 }
 
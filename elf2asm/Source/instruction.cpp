@@ -3,191 +3,261 @@
  */
 
 #include "instruction.h"
+#include "arm_disassembler.h"
+#include <array>
+#include <cctype>
+#include <cstdint>
 #include <iostream>
 #include <sstream>
 #include <algorithm>
 #include <stdexcept>
+#include <type_traits>
 #include <vector>
 #include <iterator>
 
 using namespace arm;
 
 
-command_t
-instruction_t::command_from_string(
-    const std::string& string,
-    size_t offset)
+/**
+ * Keyword lookup for mnemonics, condition codes and operand names. A
+ * keyword's key is its
+ * letters packed one byte each, first letter highest; the table is built
+ * at compile time by searching for a multiplier that sends every key to
+ * its own slot, so a lookup is one multiply, one shift and one compare.
+ */
+template <typename T>
+struct keyword {
+    const char* name;
+    T value;
+};
+
+template <typename T, unsigned Bits>
+struct keyword_table {
+    uint64_t multiplier;
+    std::array<uint64_t, (1u << Bits)> keys; /* 0 marks an empty slot */
+    std::array<T, (1u << Bits)> values;
+
+    constexpr size_t
+    slot(uint64_t key) const
+    { return (size_t)((key * multiplier) >> (64 - Bits)); }
+
+    constexpr bool
+    contains(uint64_t key) const
+    { return key != 0 && keys[slot(key)] == key; }
+
+    constexpr T
+    find(uint64_t key, T missing) const
+    { return contains(key) ? values[slot(key)] : missing; }
+};
+
+
+static constexpr uint64_t
+keyword_key(const char* name)
 {
-    if (string.size() == 0) return command_t::UNKNOWN;
-
-    std::string s(string.begin() + offset, string.end());
-    std::transform(s.begin(), s.end(), s.begin(),
-        [](unsigned char c){ return std::toupper(c); });
-
-    if (s.size() >= 5) {
-        if (s[0] == 'U' && s[1] == 'M') {
-            if (s[2] == 'A' && s[3] == 'A' && s[4] == 'L')
-                return command_t::UMAAL;
-            else if (s[2] == 'L' && s[3] == 'A' && s[4] == 'L')
-                return command_t::UMLAL;
-            else if (s[2] == 'U' && s[3] == 'L' && s[4] == 'L')
-                return command_t::UMULL;
-        }
-    }
-    if (s.size() >= 4) {
-        if (s[0] == 'B') {
-            if (s[1] == 'K' && s[2] == 'P' && s[3] == 'T')
-                return command_t::BKPT;
-        }
-        else if (s[0] == 'C') {
-            if (s[1] == 'B' && s[2] == 'N' && s[3] == 'Z')
-                return command_t::CBNZ;
-        }
-        else if (s[0] == 'M') {
-            if (s[1] == 'O' && s[2] == 'V' && s[3] == 'T')
-                return command_t::MOVT;
-        }
-        else if (s[0] == 'P') {
-            if (s[1] == 'U' && s[2] == 'S' && s[3] == 'H')
-                return command_t::PUSH;
-        }
-        else if (s[0] == 'S') {
-            if (s[1] == 'B' && s[2] == 'F' && s[3] == 'X')
-                return command_t::SBFX;
-            else if (s[1] == 'D' && s[2] == 'I' && s[3] == 'V')
-                return command_t::SDIV;
-        }
-        else if (s[0] == 'U') {
-            if (s[1] == 'D') {
-                if (s[2] == 'I' && s[3] == 'V') return command_t::UDIV;
-            }
-            else if (s[1] == 'X' && s[2] == 'T') {
-                if (s[3] == 'B') return command_t::UXTB;
-                else if (s[3] == 'H') return command_t::UXTH;
-            }
-            else if (s[1] == 'B' && s[2] == 'F' && s[3] == 'X')
-                return command_t::UBFX;
+    uint64_t key = 0;
+    while (*name) key = (key << 8) | (unsigned char)*name++;
+    return key;
+}
+
+
+template <unsigned Bits, typename Words>
+static constexpr auto
+make_keyword_table(const Words& words)
+{
+    using T = std::decay_t<decltype(words[0].value)>;
+    keyword_table<T, Bits> table{};
+    uint64_t seed = 0x9e3779b97f4a7c15ULL;
+    for (int attempt = 0; attempt < 4096; attempt++) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        table.multiplier = seed | 1;
+        for (auto& key : table.keys) key = 0;
+        bool collision = false;
+        for (const auto& word : words) {
+            uint64_t key = keyword_key(word.name);
+            size_t index = table.slot(key);
+            if (table.keys[index] != 0) collision = true;
+            table.keys[index] = key;
+            table.values[index] = word.value;
         }
+        if (!collision) return table;
     }
-    if (s.size() >= 3) {
-        if (s[0] == 'A') {
-            if (s[1] == 'D') {
-                if (s[2] == 'C') return command_t::ADC;
-                else if (s[2] == 'D') return command_t::ADD;
-                // else if (s[2] == 'R') return command_t::ADR;
-            }
-            else if (s[1] == 'N') {
-                if (s[2] == 'D') return command_t::AND;
-            }
-            else if (s[1] == 'S') {
-                if (s[2] == 'R') return command_t::ASR;
-            }
-        }
-        else if (s[0] == 'B') {
-            if (s[1] == 'F') {
-                if (s[2] == 'C') return command_t::BFC;
-                else if (s[2] == 'I') return command_t::BFI;
-            }
-            else if (s[1] == 'I') {
-                if (s[2] == 'C') return command_t::BIC;
-            }
-            else if (s[1] == 'L') {
-                if (s[2] == 'X') return command_t::BLX;
-                if (s[2] == 'E' || s[2] == 'T' || s[2] == 'S' || s[2] == 'O')
-                    return command_t::B;
-            }
-        }
-        else if (s[0] == 'C') {
-            if (s[1] == 'B') {
-                if (s[2] == 'Z') return command_t::CBZ;
-            }
-            else if (s[1] == 'L') {
-                if (s[2] == 'Z') return command_t::CLZ;
-            }
-            else if (s[1] == 'M') {
-                if (s[2] == 'P') return command_t::CMP;
-                else if (s[2] == 'N') return command_t::CMN;
-            }
-        }
-        else if (s[0] == 'E') {
-            if (s[1] == 'O' && s[2] == 'R') return command_t::EOR;
-        }
-        else if (s[0] == 'L') {
-            if (s[1] == 'D') {
-                if (s[2] == 'M') return command_t::LDM;
-                else if (s[2] == 'R') return command_t::LDR;
-            }
-            else if (s[1] == 'S') {
-                if (s[2] == 'L') return command_t::LSL;
-                else if (s[2] == 'R') return command_t::LSR;
-            }
-        }
-        else if (s[0] == 'M') {
-            if (s[1] == 'L') {
-                if (s[2] == 'A') return command_t::MLA;
-                else if (s[2] == 'S') return command_t::MLS;
-            }
-            else if (s[1] == 'O') {
-                if (s[2] == 'V') return command_t::MOV;
-            }
-            else if (s[1] == 'U') {
-                if (s[2] == 'L') return command_t::MUL;
-            }
-            else if (s[1] == 'V') {
-                if (s[2] == 'N') return command_t::MVN;
-            }
-        }
-        else if (s[0] == 'N') {
-            if (s[1] == 'O' && s[2] == 'P')
-                return command_t::NOP;
-        }
-        else if (s[0] == 'O') {
-            if (s[1] == 'R' && s[2] == 'R')
-                return command_t::ORR;
-        }
-        else if (s[0] == 'P') {
-            if (s[1] == 'O' && s[2] == 'P')
-                return command_t::POP;
-        }
-        else if (s[0] == 'R') {
-            if (s[1] == 'O') {
-                if (s[2] == 'R') return command_t::ROR;
-            }
-            else if (s[1] == 'S') {
-                if (s[2] == 'B') return command_t::RSB;
-                else if (s[2] == 'C') return command_t::RSC;
-            }
-        }
-        else if (s[0] == 'S') {
-            if (s[1] == 'B') {
-                if (s[2] == 'C') return command_t::SBC;
-            }
-            else if (s[1] == 'T') {
-                if (s[2] == 'M') return command_t::STM;
-                else if (s[2] == 'R') return command_t::STR;
-            }
-            else if (s[1] == 'U') {
-                if (s[2] == 'B') return command_t::SUB;
-            }
+    table.multiplier = 0;
+    return table;
+}
+
+
+static constexpr unsigned char
+upper(char c)
+{ return (c >= 'a' && c <= 'z') ? c - ('a' - 'A') : (unsigned char)c; }
+
+
+/* the letters before any S flag and condition: the command, and for
+   LDR/STR and LDM/STM the size or addressing mode it is spelt with */
+struct stem_t {
+    command_t command = command_t::UNKNOWN;
+    uint8_t variant = 0;  /* register_data_size or address_increment_order */
+    bool settable = false; /* takes an S flag */
+};
+
+static constexpr stem_t
+stem(command_t command, bool settable = false)
+{ return { command, 0, settable }; }
+
+static constexpr stem_t
+stem(command_t command, register_data_size size)
+{ return { command, (uint8_t)size, false }; }
+
+static constexpr stem_t
+stem(command_t command, address_increment_order order)
+{ return { command, (uint8_t)order, false }; }
+
+/* stem, S and a two-letter condition: "UMLALSEQ" */
+static constexpr size_t max_mnemonic_size = 8;
+
+static constexpr bool S = true;
+static constexpr auto IA = address_increment_order::IA;
+static constexpr auto IB = address_increment_order::IB;
+static constexpr auto DA = address_increment_order::DA;
+static constexpr auto DB = address_increment_order::DB;
+
+static constexpr keyword<stem_t> mnemonic_words[] = {
+    { "ADC",   stem(command_t::ADC, S)  }, { "ADD",   stem(command_t::ADD, S)  },
+    { "AND",   stem(command_t::AND, S)  }, { "ASR",   stem(command_t::ASR, S)  },
+    { "B",     stem(command_t::B)       }, { "BFC",   stem(command_t::BFC)     },
+    { "BFI",   stem(command_t::BFI)     }, { "BIC",   stem(command_t::BIC, S)  },
+    { "BKPT",  stem(command_t::BKPT)    }, { "BL",    stem(command_t::BL)      },
+    { "BLX",   stem(command_t::BLX)     }, { "BX",    stem(command_t::BX)      },
+    { "CBZ",   stem(command_t::CBZ)     }, { "CBNZ",  stem(command_t::CBNZ)    },
+    { "CLZ",   stem(command_t::CLZ)     }, { "CMP",   stem(command_t::CMP)     },
+    { "CMN",   stem(command_t::CMN)     }, { "EOR",   stem(command_t::EOR, S)  },
+    { "LSL",   stem(command_t::LSL, S)  }, { "LSR",   stem(command_t::LSR, S)  },
+    { "MLA",   stem(command_t::MLA, S)  }, { "MLS",   stem(command_t::MLS)     },
+    { "MOV",   stem(command_t::MOV, S)  }, { "MOVW",  stem(command_t::MOV)     },
+    { "MOVT",  stem(command_t::MOVT)    }, { "MUL",   stem(command_t::MUL, S)  },
+    { "MVN",   stem(command_t::MVN, S)  }, { "NOP",   stem(command_t::NOP)     },
+    { "ORR",   stem(command_t::ORR, S)  }, { "POP",   stem(command_t::POP)     },
+    { "PUSH",  stem(command_t::PUSH)    }, { "ROR",   stem(command_t::ROR, S)  },
+    { "RSB",   stem(command_t::RSB, S)  }, { "RSC",   stem(command_t::RSC, S)  },
+    { "SBC",   stem(command_t::SBC, S)  }, { "SBFX",  stem(command_t::SBFX)    },
+    { "SDIV",  stem(command_t::SDIV)    }, { "SUB",   stem(command_t::SUB, S)  },
+    { "TEQ",   stem(command_t::TEQ)     }, { "TST",   stem(command_t::TST)     },
+    { "UBFX",  stem(command_t::UBFX)    }, { "UDIV",  stem(command_t::UDIV)    },
+    { "UMAAL", stem(command_t::UMAAL)   }, { "UMLAL", stem(command_t::UMLAL, S) },
+    { "UMULL", stem(command_t::UMULL, S) }, { "UXTB", stem(command_t::UXTB)    },
+    { "UXTH",  stem(command_t::UXTH)    },
+
+    { "LDR",   stem(command_t::LDR, register_data_size::W)  },
+    { "LDRB",  stem(command_t::LDR, register_data_size::B)  },
+    { "LDRH",  stem(command_t::LDR, register_data_size::H)  },
+    { "LDRSB", stem(command_t::LDR, register_data_size::SB) },
+    { "LDRSH", stem(command_t::LDR, register_data_size::SH) },
+    { "LDRD",  stem(command_t::LDR, register_data_size::D)  },
+    { "STR",   stem(command_t::STR, register_data_size::W)  },
+    { "STRB",  stem(command_t::STR, register_data_size::B)  },
+    { "STRH",  stem(command_t::STR, register_data_size::H)  },
+    { "STRD",  stem(command_t::STR, register_data_size::D)  },
+
+    // the stack-style names are aliases of the same four modes
+    { "LDM",   stem(command_t::LDM, IA) }, { "STM",   stem(command_t::STM, IA) },
+    { "LDMIA", stem(command_t::LDM, IA) }, { "STMIA", stem(command_t::STM, IA) },
+    { "LDMIB", stem(command_t::LDM, IB) }, { "STMIB", stem(command_t::STM, IB) },
+    { "LDMDA", stem(command_t::LDM, DA) }, { "STMDA", stem(command_t::STM, DA) },
+    { "LDMDB", stem(command_t::LDM, DB) }, { "STMDB", stem(command_t::STM, DB) },
+    { "LDMFD", stem(command_t::LDM, IA) }, { "STMEA", stem(command_t::STM, IA) },
+    { "LDMED", stem(command_t::LDM, IB) }, { "STMFA", stem(command_t::STM, IB) },
+    { "LDMFA", stem(command_t::LDM, DA) }, { "STMED", stem(command_t::STM, DA) },
+    { "LDMEA", stem(command_t::LDM, DB) }, { "STMFD", stem(command_t::STM, DB) },
+};
+
+static constexpr auto mnemonics = make_keyword_table<10>(mnemonic_words);
+static_assert(mnemonics.multiplier != 0, "no perfect hash for the mnemonics");
+
+static constexpr keyword<condition_t> condition_words[] = {
+    { "AL", condition_t::AL }, { "EQ", condition_t::EQ },
+    { "NE", condition_t::NE }, { "CS", condition_t::CS },
+    { "HS", condition_t::HS }, { "CC", condition_t::CC },
+    { "LO", condition_t::LO }, { "MI", condition_t::MI },
+    { "PL", condition_t::PL }, { "VS", condition_t::VS },
+    { "VC", condition_t::VC }, { "HI", condition_t::HI },
+    { "LS", condition_t::LS }, { "GE", condition_t::GE },
+    { "LT", condition_t::LT }, { "GT", condition_t::GT },
+    { "LE", condition_t::LE },
+};
+
+static constexpr auto conditions = make_keyword_table<6>(condition_words);
+static_assert(conditions.multiplier != 0, "no perfect hash for the conditions");
+
+/* operand names stored by index rather than as text, registers first */
+static constexpr const char* operand_names[] = {
+    "",
+    "R0", "R1", "R2",  "R3",  "R4",  "R5",  "R6",  "R7",
+    "R8", "R9", "R10", "R11", "R12", "R13", "R14", "R15",
+    "SP", "LR", "PC",  "IP",  "FP",  "SL",  "SB",
+    "LSL", "LSR", "ASR", "ROR", "RRX",
+};
+static constexpr uint8_t last_register_name = 23;
+static constexpr size_t max_operand_name_size = 3;
+
+template <size_t N>
+static constexpr std::array<keyword<uint8_t>, N - 1>
+index_keywords(const char* const (&names)[N])
+{
+    std::array<keyword<uint8_t>, N - 1> words{};
+    for (size_t i = 1; i < N; i++) words[i - 1] = { names[i], (uint8_t)i };
+    return words;
+}
+
+static constexpr auto operands = make_keyword_table<7>(index_keywords(operand_names));
+static_assert(operands.multiplier != 0, "no perfect hash for the operand names");
+
+
+/**
+ * Splits a mnemonic (case-insensitively, without copying it) into its
+ * stem, an S flag and a condition: the whole string is looked up first,
+ * then with a trailing S, then with a trailing condition and an optional
+ * S ahead of it. So "MOVS" is MOV with S, "BLS" is B with LS, "LDRHI"
+ * is LDR with HI and "ADDSEQ" is ADD with S and EQ. A ".W" or ".N"
+ * width suffix is ignored.
+ */
+mnemonic_t
+instruction_t::classify(std::string_view string)
+{
+    mnemonic_t result = { command_t::UNKNOWN, false, condition_t::UNSPECIFIED, 0 };
+    size_t size = string.size();
+    if (size > 2 && string[size - 2] == '.' &&
+        (upper(string[size - 1]) == 'W' || upper(string[size - 1]) == 'N'))
+        size -= 2;
+    if (size == 0 || size > max_mnemonic_size) return result;
+
+    uint64_t prefix[max_mnemonic_size + 1] = { 0 };
+    for (size_t i = 0; i < size; i++)
+        prefix[i + 1] = (prefix[i] << 8) | upper(string[i]);
+
+    size_t end = size;
+    for (int pass = 0; pass < 2; pass++) {
+        if (pass == 1) {
+            if (size < 3) break;
+            uint64_t key = prefix[size] & 0xffff;
+            if (!conditions.contains(key)) break;
+            result.condition = conditions.find(key, condition_t::UNSPECIFIED);
+            end = size - 2;
         }
-        else if (s[0] == 'T') {
-            if (s[1] == 'E' && s[2] == 'Q')
-                return command_t::TEQ;
-            else if (s[1] == 'S' && s[2] == 'T')
-                return command_t::TST;
+
+        stem_t stem = mnemonics.find(prefix[end], stem_t());
+        if (stem.command == command_t::UNKNOWN && end > 1 && prefix[end] % 256 == 'S') {
+            stem = mnemonics.find(prefix[end - 1], stem_t());
+            result.set = stem.settable;
+            if (!stem.settable) stem = stem_t();
         }
-    }
-    if (s.size() >= 2) {
-        if (s[0] == 'B') {
-            if (s[1] == 'L') return command_t::BL;
-            else if (s[1] == 'X') return command_t::BX;
+        if (stem.command != command_t::UNKNOWN) {
+            result.command = stem.command;
+            result.variant = stem.variant;
+            return result;
         }
     }
-    if (s.size() >= 1) {
-        if (s[0] == 'B') return command_t::B;
-    }
 
-    return command_t::UNKNOWN;
+    result.condition = condition_t::UNSPECIFIED;
+    return result;
 }
 
 
@@ -251,81 +321,6 @@ instruction_t::command_to_string(command_t c)
 }
 
 
-size_t
-instruction_t::command_string_size(command_t c)
-{
-    switch (c) {
-    case command_t::B: return 1;
-    case command_t::BL: case command_t::BX: return 2;
-    case command_t::ADC: case command_t::ADD: //case command_t::ADR:
-    case command_t::AND: case command_t::ASR: case command_t::BFC:
-    case command_t::BFI: case command_t::BIC: case command_t::BLX:
-    case command_t::CBZ: case command_t::CLZ: case command_t::CMP:
-    case command_t::CMN: case command_t::EOR: case command_t::LDM:
-    case command_t::LDR: case command_t::LSL: case command_t::LSR:
-    case command_t::MLA: case command_t::MLS: case command_t::MOV:
-    case command_t::MUL: case command_t::MVN: case command_t::NOP:
-    case command_t::ORR: case command_t::POP: case command_t::ROR:
-    case command_t::RSB: case command_t::RSC: case command_t::SBC:
-    case command_t::STM: case command_t::STR: case command_t::SUB:
-    case command_t::TEQ: case command_t::TST: return 3;
-    case command_t::BKPT: case command_t::CBNZ: case command_t::MOVT:
-    case command_t::PUSH: case command_t::SBFX: case command_t::SDIV:
-    case command_t::UBFX: case command_t::UDIV: case command_t::UXTB:
-    case command_t::UXTH: return 4;
-    case command_t::UMAAL: case command_t::UMLAL: case command_t::UMULL: return 5;
-    default: return 0;
-    }
-}
-
-
-condition_t
-instruction_t::condition_from_chars(char a, char b)
-{
-    a = std::toupper(a);
-    b = std::toupper(b);
-
-    if (a == 'A') {
-        if (b == 'L') return condition_t::AL;
-    }
-    else if (a == 'C') {
-        if (b == 'C') return condition_t::CC;
-        else if (b == 'S') return condition_t::CS;
-    }
-    else if (a == 'E') {
-        if (b == 'Q') return condition_t::EQ;
-    }
-    else if (a == 'G') {
-        if (b == 'E') return condition_t::GE;
-        else if (b == 'T') return condition_t::GT;
-    }
-    else if (a == 'H') {
-        if (b == 'I') return condition_t::HI;
-        else if (b == 'S') return condition_t::HS;
-    }
-    else if (a == 'L') {
-        if (b == 'E') return condition_t::LE;
-        else if (b == 'O') return condition_t::LO;
-        else if (b == 'S') return condition_t::LS;
-        else if (b == 'T') return condition_t::LT;
-    }
-    else if (a == 'M') {
-        if (b == 'I') return condition_t::MI;
-    }
-    else if (a == 'N') {
-        if (b == 'E') return condition_t::NE;
-    }
-    else if (a == 'P') {
-        if (b == 'L') return condition_t::PL;
-    }
-    else if (a == 'V') {
-        if (b == 'S') return condition_t::VS;
-        else if (b == 'C') return condition_t::VC;
-    }
-    return condition_t::UNSPECIFIED;
-}
-
-
 std::string
 instruction_t::condition_to_string(condition_t c)
 {
@@ -380,7 +375,6 @@ instruction_t::string_from_condition(condition_t c)
 instruction_t
 instruction_t::parse(const std::string& line)
 {
-    instruction_t instruction;
     std::string source = line;
     size_t idx;
 
@@ -399,128 +393,193 @@ instruction_t::parse(const std::string& line)
             break;
         }
     }
-    instruction.m_comments = "";
+    std::string comments = "";
     for (size_t i = idx; i < tokens.size(); i++) {
-        if (instruction.m_comments.size() > 0)
-            instruction.m_comments += std::string(" ");
-        instruction.m_comments += tokens[i];
+        if (comments.size() > 0)
+            comments += std::string(" ");
+        comments += tokens[i];
     }
-    while (tokens.size() > idx) tokens.pop_back();
+    if (idx == 0) throw std::runtime_error("not a valid instruction");
 
-    instruction.m_original  = source;
-    instruction.m_command   = command_from_string(tokens[0]);
-    instruction.m_set       = false;
-    instruction.m_condition = condition_t::UNSPECIFIED;
-    instruction.m_info.m_increment_order    = address_increment_order::IA;
-    instruction.m_info.m_register_data_size = register_data_size::W;
-    instruction.m_order     = 0;
-    idx = command_string_size(instruction.m_command);
+    std::vector<std::string> operands(tokens.begin() + 1, tokens.begin() + idx);
+    return from_tokens(tokens[0], operands, comments, source);
+}
 
-    if (instruction.m_command == command_t::UNKNOWN)
-        throw std::runtime_error(std::string("unsupported command ") + tokens[0]);
-
-    if (idx < tokens[0].size()) {
-        auto c1 = tokens[0][idx], c2 = tokens[0][idx + 1];
-        switch (instruction.m_command) {
-        case command_t::MOV: if (c1 == 'W') idx++; break;
-        case command_t::LDM:
-        case command_t::STM:
-            if (c1 == 'I') {
-                if (c2 == 'A')      instruction.m_info.m_increment_order = address_increment_order::IA;
-                else if (c2 == 'B') instruction.m_info.m_increment_order = address_increment_order::IB;
-            }
-            else if (c1 == 'D') {
-                if (c2 == 'A')      instruction.m_info.m_increment_order = address_increment_order::DA;
-                else if (c2 == 'B') instruction.m_info.m_increment_order = address_increment_order::DB;
-            }
-            idx += 2;
-            break;
-        case command_t::LDR:
-        case command_t::STR:
-            if (c1 == 'S') {
-                if (c2 == 'B') {
-                    instruction.m_info.m_register_data_size = register_data_size::SB;
-                    idx += 2;
-                }
-                else if (c2 == 'H') {
-                    instruction.m_info.m_register_data_size = register_data_size::SH;
-                    idx += 2;
-                }
-            }
-            else if (c1 == 'B') {
-                instruction.m_info.m_register_data_size = register_data_size::B;
-                idx++;
-            }
-            else if (c1 == 'H') {
-                if (c2 != 'I' && c2 != 'S') {
-                    instruction.m_info.m_register_data_size = register_data_size::H;
-                    idx++;
-                }
-            }
-            else if (c1 == 'D') {
-                instruction.m_info.m_register_data_size = register_data_size::D;
-                idx++;
-            }
-            break;
-        default:
-            if (c1 == 'S') {
-                instruction.m_set = true;
-                idx++;
+
+instruction_t
+instruction_t::from_tokens(
+    const std::string& mnemonic,
+    const std::vector<std::string>& operands,
+    std::string_view comments,
+    std::string_view original)
+{
+    // "{r4," "lr}" -> "{r4" "lr}", as parse() would have split them
+    std::string_view tokens[max_params + 2] = { mnemonic };
+    size_t count = 1, text_size = original.size() + comments.size();
+    for (std::string_view operand : operands) {
+        size_t start = 0;
+        while (start <= operand.size()) {
+            size_t end = operand.find(',', start);
+            if (end == std::string::npos) end = operand.size();
+            if (end > start) {
+                if (count == max_params + 2)
+                    throw std::runtime_error("too many operands " + mnemonic);
+                tokens[count++] = operand.substr(start, end - start);
             }
-            break;
+            start = end + 1;
         }
+        text_size += operand.size();
     }
+    if (mnemonic.empty()) throw std::runtime_error("not a valid instruction");
+    return build(classify(mnemonic), tokens, count, comments, original, text_size);
+}
+
 
-    if (idx < (tokens[0].size() - 1)) {
-        instruction.m_condition = condition_from_chars(
-            tokens[0][idx + 0],
-            tokens[0][idx + 1]
-        );
-        idx += 2;
+/**
+ * Only the operands of a decoded record are read from its text, split at
+ * blanks and commas and uppercased as elf2asm prints them (the x of a 0x
+ * prefix stays lower case). The condition and S flag are the record's;
+ * cutting them off the printed mnemonic leaves the stem, which must start
+ * with the opcode entry's own ("ldr" for "ldrsh") and is looked up whole.
+ * So "bls" under condition LS is B, "teq" is never TE with EQ, and the s
+ * of "ldrsh" is not an S flag.
+ */
+instruction_t
+instruction_t::from_record(
+    const arm_disassembly& records,
+    size_t index,
+    std::string_view comments,
+    std::string_view original,
+    std::string_view label)
+{
+    /* arm_instruction::condition is the encoding's condition field */
+    static constexpr keyword<condition_t> record_conditions[] = {
+        { "EQ", condition_t::EQ }, { "NE", condition_t::NE },
+        { "CS", condition_t::CS }, { "CC", condition_t::CC },
+        { "MI", condition_t::MI }, { "PL", condition_t::PL },
+        { "VS", condition_t::VS }, { "VC", condition_t::VC },
+        { "HI", condition_t::HI }, { "LS", condition_t::LS },
+        { "GE", condition_t::GE }, { "LT", condition_t::LT },
+        { "GT", condition_t::GT }, { "LE", condition_t::LE },
+    };
+    const arm_instruction& record = records.instructions[index];
+    std::string_view name = records.mnemonic(index);
+    if (name.empty()) throw std::runtime_error("not a valid instruction");
+    mnemonic_t parts = { command_t::UNKNOWN, false, condition_t::UNSPECIFIED, 0 };
+
+    size_t size = name.size();
+    if (size > 2 && name[size - 2] == '.') size -= 2;
+    if (record.condition < std::size(record_conditions)) {
+        parts.condition = record_conditions[record.condition].value;
+        const char* suffix = record_conditions[record.condition].name;
+        if (size > 2 && upper(name[size - 2]) == suffix[0] && upper(name[size - 1]) == suffix[1])
+            size -= 2;
+    }
+    if ((record.flags & ARM_INSN_SETS_FLAGS) && size > 1 && upper(name[size - 1]) == 'S') {
+        parts.set = true;
+        size -= 1;
+    }
+    std::string_view stem = arm_opcode_stem(record.opcode);
+    if (size <= max_mnemonic_size && size >= stem.size() && name.substr(0, stem.size()) == stem) {
+        uint64_t key = 0;
+        for (size_t i = 0; i < size; i++) key = (key << 8) | upper(name[i]);
+        stem_t found = mnemonics.find(key, stem_t());
+        parts.command = found.command;
+        parts.variant = found.variant;
     }
 
-    if (idx != tokens[0].size())
-        throw std::runtime_error(std::string("undefined instruction detected ") + tokens[0]);
+    // the mnemonic and operands, uppercased, except a label given for them
+    std::string line(name);
+    std::string_view text = records.operands(index);
+    line += ' ';
+    if (!label.empty()) {
+        size_t end = std::min(text.find_first_of(", \t"), text.size());
+        line.append(label).append(text.substr(end));
+    }
+    else line.append(text);
+    for (size_t k = 0; k < line.size(); k++) {
+        if (k == name.size() + 1) k += label.size();
+        if (k < line.size() && (line[k] != 'x' || k == 0 || line[k - 1] != '0'))
+            line[k] = upper(line[k]);
+    }
+
+    std::string_view tokens[max_params + 2] = { std::string_view(line).substr(0, name.size()) };
+    size_t count = 1;
+    for (size_t k = name.size(); k < line.size(); ) {
+        while (k < line.size() && (line[k] == ',' || std::isspace((unsigned char)line[k]))) k++;
+        size_t start = k;
+        while (k < line.size() && line[k] != ',' && !std::isspace((unsigned char)line[k])) k++;
+        if (k == start) break;
+        if (count == max_params + 2)
+            throw std::runtime_error("too many operands " + std::string(tokens[0]));
+        tokens[count++] = std::string_view(line).substr(start, k - start);
+    }
+
+    size_t text_size = original.size() + comments.size() + line.size();
+    return build(parts, tokens, count, comments, original, text_size);
+}
+
+
+instruction_t
+instruction_t::build(
+    const mnemonic_t& parts,
+    const std::string_view* tokens,
+    size_t count,
+    std::string_view comments,
+    std::string_view original,
+    size_t text_size)
+{
+    instruction_t instruction;
+    std::string_view mnemonic = tokens[0];
+    if (text_size > UINT16_MAX)
+        throw std::runtime_error("instruction too long " + std::string(mnemonic));
+
+    instruction.m_text.reserve(text_size);
+    instruction.m_text.append(original).append(comments);
+    instruction.m_original_size = original.size();
+    instruction.m_comments_size = comments.size();
+    instruction.m_param_count = 0;
+    instruction.m_command   = parts.command;
+    instruction.m_set       = parts.set;
+    instruction.m_condition = parts.condition;
+    instruction.m_info.m_increment_order    = address_increment_order::IA;
+    instruction.m_info.m_register_data_size = register_data_size::W;
+    if (parts.command == command_t::LDM || parts.command == command_t::STM)
+        instruction.m_info.m_increment_order = (address_increment_order)parts.variant;
+    else if (parts.command == command_t::LDR || parts.command == command_t::STR)
+        instruction.m_info.m_register_data_size = (register_data_size)parts.variant;
+    instruction.m_order     = 0;
+
+    if (instruction.m_command == command_t::UNKNOWN)
+        throw std::runtime_error("unsupported command " + std::string(mnemonic));
 
     switch (instruction.m_command) {
     case command_t::LDR:
     case command_t::STR:
-        if (tokens.size() < 3) throw std::runtime_error(std::string("invalid number of arguments ") + tokens[0]);
-        instruction.m_params.push_back(tokens[1]);
-        if (tokens.back().back() == '!') {
+        if (count < 3) throw std::runtime_error("invalid number of arguments " + std::string(mnemonic));
+        instruction.add_param(tokens[1], "");
+        if (tokens[count - 1].back() == '!')
             instruction.m_order = 1;
-            tokens.back().erase(std::remove(tokens.back().begin(), tokens.back().end(), '!'), tokens.back().end());
-        }
-        else if (tokens[2].front() == '[' && tokens[2].back() == ']' && tokens.size() > 3)
+        else if (tokens[2].front() == '[' && tokens[2].back() == ']' && count > 3)
             instruction.m_order = 2;
-        std::for_each(tokens.begin() + 2, tokens.end(), [&](std::string token) {
-            token.erase(std::remove(token.begin(), token.end(), '['), token.end());
-            token.erase(std::remove(token.begin(), token.end(), ']'), token.end());
-            instruction.m_params.push_back(token);
-        });
+        for (size_t i = 2; i < count; i++)
+            instruction.add_param(tokens[i], instruction.m_order == 1 && i == count - 1 ? "!" : "");
         break;
     case command_t::LDM:
     case command_t::STM: {
-        if (tokens.size() < 3) throw std::runtime_error(std::string("invalid number of arguments ") + tokens[0]);
-        auto tokenptr = tokens.begin() + 1;
+        if (count < 3) throw std::runtime_error("invalid number of arguments " + std::string(mnemonic));
+        size_t first = 1;
         if (tokens[1].back() == '!') {
-            tokenptr++;
+            first++;
             instruction.m_order = 1;
-            tokens[1].erase(std::remove(tokens[1].begin(), tokens[1].end(), '!'), tokens[1].end());
-            instruction.m_params.push_back(tokens[1]);
+            instruction.add_param(tokens[1], "!");
         }
-        std::for_each(tokenptr, tokens.end(), [&](std::string token) {
-            token.erase(std::remove(token.begin(), token.end(), '{'), token.end());
-            token.erase(std::remove(token.begin(), token.end(), '}'), token.end());
-            instruction.m_params.push_back(token);
-        });
+        for (size_t i = first; i < count; i++)
+            instruction.add_param(tokens[i], "{}");
     } break;
     default:
-        std::for_each(tokens.begin() + 1, tokens.end(), [&](std::string token) {
-            token.erase(std::remove(token.begin(), token.end(), '{'), token.end());
-            token.erase(std::remove(token.begin(), token.end(), '}'), token.end());
-            instruction.m_params.push_back(token);
-        });
+        for (size_t i = 1; i < count; i++)
+            instruction.add_param(tokens[i], "{}");
         break;
     }
 
@@ -528,14 +587,70 @@ instruction_t::parse(const std::string& line)
 }
 
 
+void
+instruction_t::add_param(
+    std::string_view token,
+    std::string_view strip)
+{
+    if (m_param_count == max_params)
+        throw std::runtime_error("too many operands");
+
+    // "[Rn" opens an address; its brackets are dropped like the strip set
+    bool address = !token.empty() && token.front() == '[';
+    size_t offset = m_text.size();
+    for (char c : token)
+        if (c != '[' && c != ']' && strip.find(c) == std::string_view::npos)
+            m_text.push_back(c);
+    size_t size = m_text.size() - offset;
+
+    operand_t& operand = m_params[m_param_count++];
+    operand.kind   = (size > 0 && m_text[offset] == '#') ?
+        operand_kind::IMMEDIATE : operand_kind::OTHER;
+    operand.name   = 0;
+    operand.offset = offset;
+    operand.size   = size;
+    if (size <= max_operand_name_size) {
+        uint64_t key = 0;
+        for (size_t i = offset; i < m_text.size(); i++)
+            key = (key << 8) | (unsigned char)m_text[i];
+        operand.name = operands.find(key, 0);
+    }
+    if (operand.name != 0) {
+        if (operand.name > last_register_name) operand.kind = operand_kind::SHIFT;
+        else operand.kind = address ? operand_kind::MEMORY : operand_kind::REGISTER;
+        m_text.resize(offset);
+    }
+}
+
+
+shift_t
+instruction_t::shift(size_t index) const
+{
+    if (index >= m_param_count || m_params[index].kind != operand_kind::SHIFT)
+        return shift_t::NONE;
+    // operand_names lists the shifts in shift_t order after the registers
+    return (shift_t)(m_params[index].name - last_register_name);
+}
+
+
+std::string_view
+instruction_t::parameter(size_t index) const
+{
+    if (index >= m_param_count) return {};
+    const operand_t& operand = m_params[index];
+    if (operand.name != 0) return operand_names[operand.name];
+    return std::string_view(m_text).substr(operand.offset, operand.size);
+}
+
+
 std::string
 instruction_t::tag_string() const
 {
-    std::istringstream iss(this->m_original);
-    std::vector<std::string> tokens(
-        std::istream_iterator<std::string>{iss},
-        std::istream_iterator<std::string>());
-    return tokens.front();
+    const char* blank = " \t\n\v\f\r";
+    std::string_view text = to_string();
+    size_t start = std::min(text.find_first_not_of(blank), text.size());
+    size_t end = std::min(text.find_first_of(blank, start), text.size());
+    return std::string(text.substr(start, end - start));
 }
 
 
@@ -569,75 +684,81 @@ instruction_t::to_c() const
     switch (this->m_command) {
     case command_t::ADC:
         // ADC{S}{cond} {Rd}, Rn, Operand2
-        if (this->m_params.size() == 2)
-            os << m_params[0] << " += " << m_params[1] << " + CARRY";
-        else if (this->m_params.size() == 3)
-            os << m_params[0] << " = " << m_params[1] << " + " << m_params[2] << " + CARRY";
+        if (m_param_count == 2)
+            os << parameter(0) << " += " << parameter(1) << " + CARRY";
+        else if (m_param_count == 3)
+            os << parameter(0) << " = " << parameter(1) << " + " << parameter(2) << " + CARRY";
         else goto param_error;
         break;
     case command_t::ADD:
         // ADD{S}{cond} {Rd}, Rn, Operand2
-        if (this->m_params.size() == 2)
-            os << m_params[0] << " += " << m_params[1];
-        else if (this->m_params.size() == 3)
-            os << m_params[0] << " = " << m_params[1] << " + " << m_params[2];
-        else if (this->m_params.size() == 5) {
-            if (m_params[3] == "LSL") os << m_params[0] << " = " << m_params[1] << " + (" << m_params[2] << " << " << m_params[4] << ")";
-            else if (m_params[3] == "LSR" || m_params[3] == "ASR") os << m_params[0] << " = " << m_params[1] << " + (" << m_params[2] << " >> " << m_params[4] << ")";
-            else if (m_params[3] == "ROR") os << m_params[0] << " = " << m_params[1] << " + std::rotr(" << m_params[2] << ", " << m_params[4] << ")";
-            else goto param_error;
+        if (m_param_count == 2)
+            os << parameter(0) << " += " << parameter(1);
+        else if (m_param_count == 3)
+            os << parameter(0) << " = " << parameter(1) << " + " << parameter(2);
+        else if (m_param_count == 5) {
+            switch (shift(3)) {
+            case shift_t::LSL: os << parameter(0) << " = " << parameter(1) << " + (" << parameter(2) << " << " << parameter(4) << ")"; break;
+            case shift_t::LSR:
+            case shift_t::ASR: os << parameter(0) << " = " << parameter(1) << " + (" << parameter(2) << " >> " << parameter(4) << ")"; break;
+            case shift_t::ROR: os << parameter(0) << " = " << parameter(1) << " + std::rotr(" << parameter(2) << ", " << parameter(4) << ")"; break;
+            default: goto param_error;
+            }
         }
         else goto param_error;
         break;
     case command_t::AND:
         // AND{S}{cond} Rd, Rn, Operand2
-        if (this->m_params.size() == 3)
-            os << m_params[0] << " = " << m_params[1] << " & " << m_params[2];
-        else if (this->m_params.size() == 4) {
-            if (m_params[3] == "RRX") os << m_params[0] << " = " << m_params[1] << " & (" << m_params[2] << " >> 1)";
+        if (m_param_count == 3)
+            os << parameter(0) << " = " << parameter(1) << " & " << parameter(2);
+        else if (m_param_count == 4) {
+            if (shift(3) == shift_t::RRX) os << parameter(0) << " = " << parameter(1) << " & (" << parameter(2) << " >> 1)";
             else goto param_error;
         }
-        else if (this->m_params.size() == 5) {
-            if (m_params[3] == "LSL") os << m_params[0] << " = " << m_params[1] << " & (" << m_params[2] << " << " << m_params[4] << ")";
-            else if (m_params[3] == "LSR" || m_params[3] == "ASR") os << m_params[0] << " = " << m_params[1] << " & (" << m_params[2] << " >> " << m_params[4] << ")";
-            else if (m_params[3] == "ROR") os << m_params[0] << " = " << m_params[1] << " & std::rotr(" << m_params[2] << ", " << m_params[4] << ")";
-            else goto param_error;
+        else if (m_param_count == 5) {
+            switch (shift(3)) {
+            case shift_t::LSL: os << parameter(0) << " = " << parameter(1) << " & (" << parameter(2) << " << " << parameter(4) << ")"; break;
+            case shift_t::LSR:
+            case shift_t::ASR: os << parameter(0) << " = " << parameter(1) << " & (" << parameter(2) << " >> " << parameter(4) << ")"; break;
+            case shift_t::ROR: os << parameter(0) << " = " << parameter(1) << " & std::rotr(" << parameter(2) << ", " << parameter(4) << ")"; break;
+            default: goto param_error;
+            }
         }
         else goto param_error;
         break;
     case command_t::ASR:
         // ASR{S}{cond} Rd, Rm, Rs
-        if (this->m_params.size() == 3)
-            os << m_params[0] << " = (signed)" << m_params[1] << " >> " << m_params[2];
+        if (m_param_count == 3)
+            os << parameter(0) << " = (signed)" << parameter(1) << " >> " << parameter(2);
         else goto param_error;
         break;
     case command_t::B:
         // B{cond} label
-        if (this->m_params.size() == 1)
-            os << "goto " << m_params[0];
+        if (m_param_count == 1)
+            os << "goto " << parameter(0);
         else goto param_error;
         break;
     case command_t::BFC:
         // BFC{cond} Rd, #lsb, #width
         // Rd &= ~((2^#width - 1) << #lsb)
-        if (this->m_params.size() == 3)
-            os << m_params[0] << " &= ~(bitfield(" << m_params[2] << ") << " << m_params[1] << ")";
+        if (m_param_count == 3)
+            os << parameter(0) << " &= ~(bitfield(" << parameter(2) << ") << " << parameter(1) << ")";
         else goto param_error;
         break;
     case command_t::BFI:
         // BFI{cond} Rd, Rn, #lsb, #width
         // Rd = (Rd & (~((2^#width - 1) << #lsb))) | (Rn & ((2^#width - 1) << #lsb))
-        if (this->m_params.size() == 4) {
-            os << m_params[0] << " = (";
-            os << m_params[0] << " & ~(bitfield(" << m_params[3] << ") << " << m_params[2] << ")) | (";
-            os << m_params[1] << " &  (bitfield(" << m_params[3] << ") << " << m_params[2] << "))";
+        if (m_param_count == 4) {
+            os << parameter(0) << " = (";
+            os << parameter(0) << " & ~(bitfield(" << parameter(3) << ") << " << parameter(2) << ")) | (";
+            os << parameter(1) << " &  (bitfield(" << parameter(3) << ") << " << parameter(2) << "))";
         }
         else goto param_error;
         break;
     case command_t::BIC:
         // BIC{S}{cond} Rd, Rn, Operand2
-        if (this->m_params.size() == 3)
-            os << m_params[0] << " = " << m_params[1] << " & ~(" << m_params[2] << ")";
+        if (m_param_count == 3)
+            os << parameter(0) << " = " << parameter(1) << " & ~(" << parameter(2) << ")";
         else goto param_error;
         break;
     case command_t::BL:
@@ -645,61 +766,64 @@ instruction_t::to_c() const
         // BL{cond} label
         // BLX{cond} label
         // BLX{cond} Rm
-        if (this->m_params.size() == 1)
-            os << "(fn)(" << m_params[0] << ")()";
+        if (m_param_count == 1)
+            os << "(fn)(" << parameter(0) << ")()";
         else goto param_error;
         break;
     case command_t::BX:
         // BX{cond} Rm
-        if (this->m_params.size() == 1)
-            os << "return [" << m_params[0] << "]";
+        if (m_param_count == 1)
+            os << "return [" << parameter(0) << "]";
         else goto param_error;
         break;
     case command_t::CBZ:
         // CBZ Rn, label
-        if (this->m_params.size() == 2)
-            os << "if (" << m_params[0] << " == 0) goto " << m_params[1];
+        if (m_param_count == 2)
+            os << "if (" << parameter(0) << " == 0) goto " << parameter(1);
         else goto param_error;
         break;
     case command_t::CBNZ:
         // CBNZ Rn, label
-        if (this->m_params.size() == 2)
-            os << m_params[0] << " &= ~(bitfield(" << m_params[2] << ") << " << m_params[1] << ")";
+        if (m_param_count == 2)
+            os << parameter(0) << " &= ~(bitfield(" << parameter(2) << ") << " << parameter(1) << ")";
         else goto param_error;
         break;
     case command_t::CLZ:
         // CLZ{cond} Rd, Rm
-        if (this->m_params.size() == 2)
-            os << m_params[0] << " = (" << m_params[1] << " == 0 ? 32 : __builtin_clz(" << m_params[1] << ")";
+        if (m_param_count == 2)
+            os << parameter(0) << " = (" << parameter(1) << " == 0 ? 32 : __builtin_clz(" << parameter(1) << ")";
         else goto param_error;
         break;
     case command_t::CMP:
         // CMP{cond} Rn, Operand2
-        if (this->m_params.size() == 2)
-            os << "if ((" << m_params[0] << " - " << m_params[1] << ") ? X) ...";
+        if (m_param_count == 2)
+            os << "if ((" << parameter(0) << " - " << parameter(1) << ") ? X) ...";
         else goto param_error;
         break;
     case command_t::CMN:
         // CMN{cond} Rn, Operand2
-        if (this->m_params.size() == 2)
-            os << "if ((" << m_params[0] << " + " << m_params[1] << ") ? X) ...";
+        if (m_param_count == 2)
+            os << "if ((" << parameter(0) << " + " << parameter(1) << ") ? X) ...";
         else goto param_error;
         break;
     case command_t::EOR:
         // EOR{S}{cond} Rd, Rn, Operand2
-        if (this->m_params.size() == 3)
-            os << m_params[0] << " = " << m_params[1] << " ^ " << m_params[2];
-        else if (this->m_params.size() == 5) {
-            if (m_params[3] == "LSL") os << m_params[0] << " = " << m_params[1] << " ^ (" << m_params[2] << " << " << m_params[4] << ")";
-            else if (m_params[3] == "LSR" || m_params[3] == "ASR") os << m_params[0] << " = " << m_params[1] << " ^ (" << m_params[2] << " >> " << m_params[4] << ")";
-            else if (m_params[3] == "ROR") os << m_params[0] << " = " << m_params[1] << " ^ std::rotr(" << m_params[2] << ", " << m_params[4] << ")";
-            else goto param_error;
+        if (m_param_count == 3)
+            os << parameter(0) << " = " << parameter(1) << " ^ " << parameter(2);
+        else if (m_param_count == 5) {
+            switch (shift(3)) {
+            case shift_t::LSL: os << parameter(0) << " = " << parameter(1) << " ^ (" << parameter(2) << " << " << parameter(4) << ")"; break;
+            case shift_t::LSR:
+            case shift_t::ASR: os << parameter(0) << " = " << parameter(1) << " ^ (" << parameter(2) << " >> " << parameter(4) << ")"; break;
+            case shift_t::ROR: os << parameter(0) << " = " << parameter(1) << " ^ std::rotr(" << parameter(2) << ", " << parameter(4) << ")"; break;
+            default: goto param_error;
+            }
         }
         else goto param_error;
         break;
     case command_t::LDM:
         // LDM{addr_mode}{cond} Rn{!}, reglist{^}
-        if (this->m_params.size() >= 2) {
+        if (m_param_count >= 2) {
             ssize_t k;
             auto o = "";
             switch (m_info.m_increment_order) {
@@ -708,11 +832,11 @@ instruction_t::to_c() const
             case address_increment_order::IB: k = 4; o = " + "; break;
             case address_increment_order::DB: k = 4; o = " - "; break;
             }
-            for (size_t n = 1; n < m_params.size(); n++) {
-                os << m_params[n] << " = *(" << m_params[0] << o << k << "); ";
+            for (size_t n = 1; n < m_param_count; n++) {
+                os << parameter(n) << " = *(" << parameter(0) << o << k << "); ";
                 k += 4;
             }
-            if (m_order == 1) os << m_params[0] << " += " << (k - 4);
+            if (m_order == 1) os << parameter(0) << " += " << (k - 4);
         }
         else goto param_error;
         break;
@@ -732,155 +856,163 @@ instruction_t::to_c() const
         case register_data_size::SB: note = "(int8_t)";   break;
         case register_data_size::SH: note = "(int16_t)";  break;
         }
-        if (this->m_params.size() == 2)
-            os << m_params[0] << " = *" << note << "(" << m_params[1] << ")";
-        else if (this->m_params.size() == 3) {
+        if (m_param_count < 2 || parameter_kind(1) != operand_kind::MEMORY)
+            goto param_error;
+        if (m_param_count == 2)
+            os << parameter(0) << " = *" << note << "(" << parameter(1) << ")";
+        else if (m_param_count == 3) {
             if (m_order == 1)
-                os << m_params[0] << " = *" << note << "(" << m_params[1] << " + " << m_params[2] << "); " << m_params[1] << " += " << m_params[2];
+                os << parameter(0) << " = *" << note << "(" << parameter(1) << " + " << parameter(2) << "); " << parameter(1) << " += " << parameter(2);
             else if (m_order == 2)
-                os << m_params[0] << " = *" << note << "(" << m_params[1] << "); " << m_params[1] << " += " << m_params[2];
-            else os << m_params[0] << " = *" << note << "(" << m_params[1] << " + " << m_params[2] << ")";
+                os << parameter(0) << " = *" << note << "(" << parameter(1) << "); " << parameter(1) << " += " << parameter(2);
+            else os << parameter(0) << " = *" << note << "(" << parameter(1) << " + " << parameter(2) << ")";
         }
-        else if (this->m_params.size() == 5) {
+        else if (m_param_count == 5) {
             const auto&
-                a = m_params[0],
-                b = m_params[1],
-                c = m_params[2],
-                d = m_params[4];
-            if (m_params[3] == "ROR") {
+                a = parameter(0),
+                b = parameter(1),
+                c = parameter(2),
+                d = parameter(4);
+            switch (shift(3)) {
+            case shift_t::ROR:
                 if (m_order == 1)
                     os << a << " = *" << note << "(" << b << " + std::rotr(" << c << ", " << d << ")); " << b << " += std::rotr(" << c << ", " << d << ")";
                 else if (m_order == 2)
                     os << a << " = *" << note << "(" << b << "); " << b << " += std::rotr(" << c << ", " << d << ")";
                 else os << a << " = *" << note << "(" << b << " + std::rotr(" << c << ", " << d << "))";
-            }
-            else if (m_params[3] == "ASR" || m_params[3] == "LSR") {
+                break;
+            case shift_t::ASR:
+            case shift_t::LSR:
                 if (m_order == 1)
                     os << a << " = *" << note << "(" << b << " + (" << c << " >> " << d << ")); " << b << " += (" << c << " >> " << d << ")";
                 else if (m_order == 2)
                     os << a << " = *" << note << "(" << b << "); " << b << " += (" << c << " >> " << d << ")";
                 else os << a << " = *" << note << "(" << b << " + (" << c << " >> " << d << "))";
-            }
-            else if (m_params[3] == "LSL") {
+                break;
+            case shift_t::LSL:
                 if (m_order == 1)
                     os << a << " = *" << note << "(" << b << " + (" << c << " << " << d << ")); " << b << " += (" << c << " << " << d << ")";
                 else if (m_order == 2)
                     os << a << " = *" << note << "(" << b << "); " << b << " += (" << c << " << " << d << ")";
                 else os << a << " = *" << note << "(" << b << " + (" << c << " << " << d << "))";
+                break;
+            default: goto param_error;
             }
-            else goto param_error;
         }
         else goto param_error;
     } break;
     case command_t::LSL:
         // LSL{S}{cond} Rd, Rm, Rs
-        if (this->m_params.size() == 3)
-            os << m_params[0] << " = " << m_params[1] << " << " << m_params[2];
+        if (m_param_count == 3)
+            os << parameter(0) << " = " << parameter(1) << " << " << parameter(2);
         else goto param_error;
         break;
     case command_t::LSR:
         // LSR{S}{cond} Rd, Rm, Rs
-        if (this->m_params.size() == 3)
-            os << m_params[0] << " = " << m_params[1] << " >> " << m_params[2];
+        if (m_param_count == 3)
+            os << parameter(0) << " = " << parameter(1) << " >> " << parameter(2);
         else goto param_error;
         break;
     case command_t::MLA:
         // MLA{S}{cond} Rd, Rn, Rm, Ra
-        if (this->m_params.size() == 4)
-            os << m_params[0] << " = (" << m_params[1] << " * " << m_params[2] << ") + " << m_params[3];
+        if (m_param_count == 4)
+            os << parameter(0) << " = (" << parameter(1) << " * " << parameter(2) << ") + " << parameter(3);
         else goto param_error;
         break;
     case command_t::MLS:
         // MLS{cond} Rd, Rn, Rm, Ra
-        if (this->m_params.size() == 4)
-            os << m_params[0] << " = (" << m_params[1] << " * " << m_params[2] << ") - " << m_params[3];
+        if (m_param_count == 4)
+            os << parameter(0) << " = (" << parameter(1) << " * " << parameter(2) << ") - " << parameter(3);
         else goto param_error;
         break;
     case command_t::MOV:
         // MOV{S}{cond} Rd, Operand2
-        if (this->m_params.size() == 2)
-            os << m_params[0] << " = " << m_params[1];
+        if (m_param_count == 2)
+            os << parameter(0) << " = " << parameter(1);
         else goto param_error;
         break;
     case command_t::MOVT:
         // MOVT{cond} Rd, #imm16
-        if (this->m_params.size() == 2)
-            os << m_params[0] << " = (0xFFFF & " << m_params[0] << ") | (" << m_params[1] << " << 16)";
+        if (m_param_count == 2)
+            os << parameter(0) << " = (0xFFFF & " << parameter(0) << ") | (" << parameter(1) << " << 16)";
         else goto param_error;
         break;
     case command_t::MUL:
         // MUL{S}{cond} {Rd}, Rn, Rm
-        if (this->m_params.size() == 2)
-            os << m_params[0] << " *= " << m_params[1];
-        else if (this->m_params.size() == 3)
-            os << m_params[0] << " = " << m_params[1] << " * " << m_params[2];
+        if (m_param_count == 2)
+            os << parameter(0) << " *= " << parameter(1);
+        else if (m_param_count == 3)
+            os << parameter(0) << " = " << parameter(1) << " * " << parameter(2);
         else goto param_error;
         break;
     case command_t::MVN:
         // MVN{S}{cond} Rd, Operand2
-        if (this->m_params.size() == 2)
-            os << m_params[0] << " = ~" << m_params[1];
+        if (m_param_count == 2)
+            os << parameter(0) << " = ~" << parameter(1);
         else goto param_error;
         break;
     case command_t::ORR:
         // ORR{S}{cond} Rd, Rn, Operand2
-        if (this->m_params.size() == 3)
-            os << m_params[0] << " = " << m_params[1] << " | " << m_params[2];
-        else if (this->m_params.size() == 5) {
-            if (m_params[3] == "LSL") os << m_params[0] << " = " << m_params[1] << " | (" << m_params[2] << " << " << m_params[4] << ")";
-            else if (m_params[3] == "LSR" || m_params[3] == "ASR") os << m_params[0] << " = " << m_params[1] << " | (" << m_params[2] << " >> " << m_params[4] << ")";
-            else if (m_params[3] == "ROR") os << m_params[0] << " = " << m_params[1] << " | std::rotr(" << m_params[2] << ", " << m_params[4] << ")";
-            else goto param_error;
+        if (m_param_count == 3)
+            os << parameter(0) << " = " << parameter(1) << " | " << parameter(2);
+        else if (m_param_count == 5) {
+            switch (shift(3)) {
+            case shift_t::LSL: os << parameter(0) << " = " << parameter(1) << " | (" << parameter(2) << " << " << parameter(4) << ")"; break;
+            case shift_t::LSR:
+            case shift_t::ASR: os << parameter(0) << " = " << parameter(1) << " | (" << parameter(2) << " >> " << parameter(4) << ")"; break;
+            case shift_t::ROR: os << parameter(0) << " = " << parameter(1) << " | std::rotr(" << parameter(2) << ", " << parameter(4) << ")"; break;
+            default: goto param_error;
+            }
         }
         else goto param_error;
         break;
     case command_t::ROR:
         // ROR{S}{cond} Rd, Rm, Rs
-        if (this->m_params.size() == 3)
-            os << m_params[0] << " = std::rotr(" << m_params[1] << ", " << m_params[2] << ")";
+        if (m_param_count == 3)
+            os << parameter(0) << " = std::rotr(" << parameter(1) << ", " << parameter(2) << ")";
         else goto param_error;
         break;
     case command_t::RSB:
         // RSB{S}{cond} {Rd}, Rn, Operand2
-        if (this->m_params.size() == 2)
-            os << m_params[0] << " = " << m_params[1] << " - " << m_params[0];
-        else if (this->m_params.size() == 3)
-            os << m_params[0] << " = " << m_params[2] << " - " << m_params[1];
+        if (m_param_count == 2)
+            os << parameter(0) << " = " << parameter(1) << " - " << parameter(0);
+        else if (m_param_count == 3)
+            os << parameter(0) << " = " << parameter(2) << " - " << parameter(1);
         else goto param_error;
         break;
     case command_t::RSC:
         // RSC{S}{cond} {Rd}, Rn, Operand2
-        if (this->m_params.size() == 2)
-            os << m_params[0] << " = " << m_params[1] << " - " << m_params[0] << " - !CARRY";
-        else if (this->m_params.size() == 3)
-            os << m_params[0] << " = " << m_params[2] << " - " << m_params[1] << " - !CARRY";
+        if (m_param_count == 2)
+            os << parameter(0) << " = " << parameter(1) << " - " << parameter(0) << " - !CARRY";
+        else if (m_param_count == 3)
+            os << parameter(0) << " = " << parameter(2) << " - " << parameter(1) << " - !CARRY";
         else goto param_error;
         break;
     case command_t::SBC:
         // SBC{S}{cond} {Rd}, Rn, Operand2
-        if (this->m_params.size() == 2)
-            os << m_params[0] << " -= " << m_params[1] << " - !CARRY";
-        else if (this->m_params.size() == 3)
-            os << m_params[0] << " = " << m_params[1] << " - " << m_params[2] << " - !CARRY";
+        if (m_param_count == 2)
+            os << parameter(0) << " -= " << parameter(1) << " - !CARRY";
+        else if (m_param_count == 3)
+            os << parameter(0) << " = " << parameter(1) << " - " << parameter(2) << " - !CARRY";
         else goto param_error;
         break;
     case command_t::SBFX:
         // SBFX{cond} Rd, Rn, #lsb, #width
-        if (this->m_params.size() == 4)
-            os << m_params[0] << " = ((signed)" << m_params[1] << " & ~(bitfield(" << m_params[3] << ") << " << m_params[2] << ")";
+        if (m_param_count == 4)
+            os << parameter(0) << " = ((signed)" << parameter(1) << " & ~(bitfield(" << parameter(3) << ") << " << parameter(2) << ")";
         else goto param_error;
         break;
     case command_t::SDIV:
         // SDIV{cond} {Rd}, Rn, Rm
-        if (this->m_params.size() == 2)
-            os << m_params[0] << " /= (signed)" << m_params[1];
-        else if (this->m_params.size() == 3)
-            os << m_params[0] << " = (signed)" << m_params[1] << " / (signed)" << m_params[2];
+        if (m_param_count == 2)
+            os << parameter(0) << " /= (signed)" << parameter(1);
+        else if (m_param_count == 3)
+            os << parameter(0) << " = (signed)" << parameter(1) << " / (signed)" << parameter(2);
         else goto param_error;
         break;
     case command_t::STM:
         // STM{addr_mode}{cond} Rn{!}, reglist{^}
-        if (this->m_params.size() >= 2) {
+        if (m_param_count >= 2) {
             ssize_t k;
             auto o = "";
             switch (m_info.m_increment_order) {
@@ -889,11 +1021,11 @@ instruction_t::to_c() const
             case address_increment_order::IB: k = 4; o = " + "; break;
             case address_increment_order::DB: k = 4; o = " - "; break;
             }
-            for (size_t n = 1; n < m_params.size(); n++) {
-                os << "*(" << m_params[0] << o << k << ") = " << m_params[n] << "; ";
+            for (size_t n = 1; n < m_param_count; n++) {
+                os << "*(" << parameter(0) << o << k << ") = " << parameter(n) << "; ";
                 k += 4;
             }
-            if (m_order == 1) os << m_params[0] << " += " << (k - 4);
+            if (m_order == 1) os << parameter(0) << " += " << (k - 4);
         }
         else goto param_error;
         break;
@@ -913,126 +1045,131 @@ instruction_t::to_c() const
         case register_data_size::SB: note = "(int8_t)";   break;
         case register_data_size::SH: note = "(int16_t)";  break;
         }
-        if (this->m_params.size() == 2)
-            os << "*" << note << "(" << m_params[1] << ") = " << m_params[0];
-        else if (this->m_params.size() == 3) {
+        if (m_param_count < 2 || parameter_kind(1) != operand_kind::MEMORY)
+            goto param_error;
+        if (m_param_count == 2)
+            os << "*" << note << "(" << parameter(1) << ") = " << parameter(0);
+        else if (m_param_count == 3) {
             if (m_order == 1)
-                os << "*" << note << "(" << m_params[1] << " + " << m_params[2] << ") = " << m_params[0] << "; " << m_params[1] << " += " << m_params[2];
+                os << "*" << note << "(" << parameter(1) << " + " << parameter(2) << ") = " << parameter(0) << "; " << parameter(1) << " += " << parameter(2);
             else if (m_order == 2)
-                os << "*" << note << "(" << m_params[1] << ") = " << m_params[0] << "; " << m_params[1] << " += " << m_params[2];
-            else os << "*" << note << "(" << m_params[1] << " + " << m_params[2] << ") = " << m_params[0];
+                os << "*" << note << "(" << parameter(1) << ") = " << parameter(0) << "; " << parameter(1) << " += " << parameter(2);
+            else os << "*" << note << "(" << parameter(1) << " + " << parameter(2) << ") = " << parameter(0);
         }
-        else if (this->m_params.size() == 5) {
+        else if (m_param_count == 5) {
             const auto&
-                a = m_params[0],
-                b = m_params[1],
-                c = m_params[2],
-                d = m_params[4];
-            if (m_params[3] == "ROR") {
+                a = parameter(0),
+                b = parameter(1),
+                c = parameter(2),
+                d = parameter(4);
+            switch (shift(3)) {
+            case shift_t::ROR:
                 if (m_order == 1)
                     os << "*" << note << "(" << b << " + std::rotr(" << c << ", " << d << "))" << a << "; " << b << " += std::rotr(" << c << ", " << d << ")";
                 else if (m_order == 2)
                     os << "*" << note << "(" << b << ") = " << a << "; " << b << " += std::rotr(" << c << ", " << d << ")";
                 else os << "*" << note << "(" << b << " + std::rotr(" << c << ", " << d << ")) = " << a;
-            }
-            else if (m_params[3] == "ASR" || m_params[3] == "LSR") {
+                break;
+            case shift_t::ASR:
+            case shift_t::LSR:
                 if (m_order == 1)
                     os << "*" << note << "(" << b << " + (" << c << " >> " << d << ")) = " << a << "; " << b << " += (" << c << " >> " << d << ")";
                 else if (m_order == 2)
                     os << "*" << note << "(" << b << ") = " << a << "; " << b << " += (" << c << " >> " << d << ")";
                 else os << "*" << note << "(" << b << " + (" << c << " >> " << d << ")) = " << a;
-            }
-            else if (m_params[3] == "LSL") {
+                break;
+            case shift_t::LSL:
                 if (m_order == 1)
                     os << "*" << note << "(" << b << " + (" << c << " << " << d << ")) = " << a << "; " << b << " += (" << c << " << " << d << ")";
                 else if (m_order == 2)
                     os << "*" << note << "(" << b << ") = " << a << "; " << b << " += (" << c << " << " << d << ")";
                 else os << "*" << note << "(" << b << " + (" << c << " << " << d << ")) = " << a;
+                break;
+            default: goto param_error;
             }
-            else goto param_error;
         }
         else goto param_error;
     } break;
     case command_t::SUB:
         // SUB{S}{cond} {Rd}, Rn, Operand2
-        if (this->m_params.size() == 2)
-            os << m_params[0] << " -= " << m_params[1];
-        else if (this->m_params.size() == 3)
-            os << m_params[0] << " = " << m_params[1] << " - " << m_params[2];
+        if (m_param_count == 2)
+            os << parameter(0) << " -= " << parameter(1);
+        else if (m_param_count == 3)
+            os << parameter(0) << " = " << parameter(1) << " - " << parameter(2);
         else goto param_error;
         break;
     case command_t::TEQ:
         // TEQ{cond} Rn, Operand2
-        if (this->m_params.size() == 2)
-            os << "if ((" << m_params[0] << " ^ " << m_params[1] << ") ? X) ...";
+        if (m_param_count == 2)
+            os << "if ((" << parameter(0) << " ^ " << parameter(1) << ") ? X) ...";
         else goto param_error;
         break;
     case command_t::TST:
         // TST{cond} Rn, Operand2
-        if (this->m_params.size() == 2)
-            os << "if ((" << m_params[0] << " & " << m_params[1] << ") ? X) ...";
+        if (m_param_count == 2)
+            os << "if ((" << parameter(0) << " & " << parameter(1) << ") ? X) ...";
         else goto param_error;
         break;
     case command_t::UBFX:
         // UBFX{cond} Rd, Rn, #lsb, #width
-        if (this->m_params.size() == 4)
-            os << m_params[0] << " = ((unsigned)" << m_params[1] << " & ~(bitfield(" << m_params[3] << ") << " << m_params[2] << ")";
+        if (m_param_count == 4)
+            os << parameter(0) << " = ((unsigned)" << parameter(1) << " & ~(bitfield(" << parameter(3) << ") << " << parameter(2) << ")";
         else goto param_error;
         break;
     case command_t::UDIV:
         // UDIV{cond} {Rd}, Rn, Rm
-        if (this->m_params.size() == 2)
-            os << m_params[0] << " /= (unsigned)" << m_params[1];
-        else if (this->m_params.size() == 3)
-            os << m_params[0] << " = (unsigned)" << m_params[1] << " / (unsigned)" << m_params[2];
+        if (m_param_count == 2)
+            os << parameter(0) << " /= (unsigned)" << parameter(1);
+        else if (m_param_count == 3)
+            os << parameter(0) << " = (unsigned)" << parameter(1) << " / (unsigned)" << parameter(2);
         else goto param_error;
         break;
     case command_t::UMAAL:
         // UMAAL{cond} RdLo, RdHi, Rn, Rm
-        if (this->m_params.size() == 4)
-            os << m_params[0] << m_params[1] << " = (" << m_params[2] << " * " << m_params[3] << ") + " << m_params[0] << " + " << m_params[1];
+        if (m_param_count == 4)
+            os << parameter(0) << parameter(1) << " = (" << parameter(2) << " * " << parameter(3) << ") + " << parameter(0) << " + " << parameter(1);
         else goto param_error;
         break;
     case command_t::UMLAL:
         // UMLAL{S}{cond} RdLo, RdHi, Rn, Rm
-        if (this->m_params.size() == 4)
-            os << m_params[0] << m_params[1] << " = (" << m_params[2] << " * " << m_params[3] << ") + ((" << m_params[0] << " << 32) | " << m_params[1] << ")";
+        if (m_param_count == 4)
+            os << parameter(0) << parameter(1) << " = (" << parameter(2) << " * " << parameter(3) << ") + ((" << parameter(0) << " << 32) | " << parameter(1) << ")";
         else goto param_error;
         break;
     case command_t::UMULL:
         // UMULL{S}{cond} RdLo, RdHi, Rn, Rm
-        if (this->m_params.size() == 4)
-            os << m_params[0] << m_params[1] << " = (" << m_params[2] << " * " << m_params[3] << ")";
+        if (m_param_count == 4)
+            os << parameter(0) << parameter(1) << " = (" << parameter(2) << " * " << parameter(3) << ")";
         else goto param_error;
         break;
     case command_t::UXTB:
         // UXTB{cond} {Rd}, Rm {,rotation}
-        if (this->m_params.size() == 1)
-            os << m_params[0] << " &= 0xFF";
-        else if (this->m_params.size() == 2)
-            os << m_params[0] << " = " << m_params[1] << " & 0xFF";
-        else if (this->m_params.size() == 3 && this->m_params[1] == "ROR")
-            os << m_params[0] << " = std::rotr(" << m_params[0] << ", " << m_params[2] << ") & 0xFF";
-        else if (this->m_params.size() == 4 && this->m_params[2] == "ROR")
-            os << m_params[0] << " = std::rotr(" << m_params[1] << ", " << m_params[3] << ") & 0xFF";
+        if (m_param_count == 1)
+            os << parameter(0) << " &= 0xFF";
+        else if (m_param_count == 2)
+            os << parameter(0) << " = " << parameter(1) << " & 0xFF";
+        else if (m_param_count == 3 && shift(1) == shift_t::ROR)
+            os << parameter(0) << " = std::rotr(" << parameter(0) << ", " << parameter(2) << ") & 0xFF";
+        else if (m_param_count == 4 && shift(2) == shift_t::ROR)
+            os << parameter(0) << " = std::rotr(" << parameter(1) << ", " << parameter(3) << ") & 0xFF";
         break;
         break;
     case command_t::UXTH:
         // UXTH{cond} {Rd}, Rm {,rotation}
-        if (this->m_params.size() == 1)
-            os << m_params[0] << " &= 0xFFFF";
-        else if (this->m_params.size() == 2)
-            os << m_params[0] << " = " << m_params[1] << " & 0xFFFF";
-        else if (this->m_params.size() == 3 && this->m_params[1] == "ROR")
-            os << m_params[0] << " = std::rotr(" << m_params[0] << ", " << m_params[2] << ") & 0xFFFF";
-        else if (this->m_params.size() == 4 && this->m_params[2] == "ROR")
-            os << m_params[0] << " = std::rotr(" << m_params[1] << ", " << m_params[3] << ") & 0xFFFF";
+        if (m_param_count == 1)
+            os << parameter(0) << " &= 0xFFFF";
+        else if (m_param_count == 2)
+            os << parameter(0) << " = " << parameter(1) << " & 0xFFFF";
+        else if (m_param_count == 3 && shift(1) == shift_t::ROR)
+            os << parameter(0) << " = std::rotr(" << parameter(0) << ", " << parameter(2) << ") & 0xFFFF";
+        else if (m_param_count == 4 && shift(2) == shift_t::ROR)
+            os << parameter(0) << " = std::rotr(" << parameter(1) << ", " << parameter(3) << ") & 0xFFFF";
         break;
-    default: os << "asm(\"" << this->m_original << "\")"; break;
+    default: os << "asm(\"" << to_string() << "\")"; break;
     }
 
-    if (this->m_comments.size() > 0)
-        os << "; // " << this->m_comments;
+    if (m_comments_size > 0)
+        os << "; // " << comments();
     else os << ";";
     return os.str();
 
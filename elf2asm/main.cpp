@@ -3,6 +3,8 @@
  */
 
 #include <unistd.h>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <iomanip>
 #include <fstream>
@@ -11,29 +13,35 @@
 #include <iterator>
 #include <algorithm>
 #include <vector>
-#include <set>
+#include <map>
+#include <atomic>
+#include <filesystem>
+#include <mutex>
 
 #include "elf_object.h"
 #include "arm_disassembler.h"
+#include "decode_cache.h"
 #include "instruction.h"
+#include "parallel_for.h"
 
 using namespace arm;
 
-elf_object obj;
+decode_cache cache = decode_cache::from_environment();
+bool memoize = false; // -m
 
-int read_elf_file(std::string filename) {
+int read_elf_file(const std::string& filename, elf_object& obj, std::ostream& out) {
     std::ifstream elf_file;
     elf_file.open(filename);
 
     if (!elf_file.is_open()) {
-        std::cout << "Error opening file " << filename << "\n";
+        out << "Error opening file " << filename << "\n";
         return 1;
     }
 
     try { obj = elf_object::parse(elf_file); }
     catch (std::exception& e) {
-        std::cout << "Error parsing elf file\n";
-        std::cout << e.what() << std::endl;
+        out << "Error parsing elf file\n";
+        out << e.what() << std::endl;
         return 1;
     }
 
@@ -41,31 +49,31 @@ int read_elf_file(std::string filename) {
     return 0;
 }
 
-void print_variable_data() {
-    std::cout << "@\n@ -- FILES --\n@\n\n";
+void print_variable_data(const elf_object& obj, std::ostream& out) {
+    out << "@\n@ -- FILES --\n@\n\n";
     for (const auto& symbol : obj.symbols())
         if (symbol.type == elf_object::sym_type_t::FILE)
-            std::cout << "@ " << ((symbol.name.size() == 0) ? "[no name]" : symbol.name) << "\n";
-    std::cout << "\n\n";
+            out << "@ " << ((symbol.name.size() == 0) ? "[no name]" : symbol.name) << "\n";
+    out << "\n\n";
 
     for (const auto& section : obj.sections()) {
         if (section.name.find(".bss") != section.name.npos)
-            std::cout << "unsigned char " << section.name.substr(1) << "[" << section.size << "];\n\n";
+            out << "unsigned char " << section.name.substr(1) << "[" << section.size << "];\n\n";
         else if (section.name.find(".data") != section.name.npos) {
-            std::cout << "unsigned char " << section.name.substr(1);
-            std::cout << "[" << section.size << "] = {";
-            std::cout << std::hex << std::setfill('0');
+            out << "unsigned char " << section.name.substr(1);
+            out << "[" << section.size << "] = {";
+            out << std::hex << std::setfill('0');
             for (size_t i = 0; i < section.raw_data.size(); i++) {
-                if (i % 16 == 0) std::cout << "\n    /*" << std::setw(4) << i << "*/ ";
-                std::cout << "0x" << std::setw(2);
-                std::cout << (int)(0xFF & section.raw_data[i]) << ", ";
+                if (i % 16 == 0) out << "\n    /*" << std::setw(4) << i << "*/ ";
+                out << "0x" << std::setw(2);
+                out << (int)(0xFF & section.raw_data[i]) << ", ";
             }
-            std::cout << std::dec << std::setfill(' ');
-            std::cout << "\n};\n\n";
+            out << std::dec << std::setfill(' ');
+            out << "\n};\n\n";
         }
         else if (section.name.find(".rodata") != section.name.npos) {
             const auto& data = section.raw_data;
-            auto caps_name = section.name;
+            std::string caps_name(section.name);
             std::transform(caps_name.begin(), caps_name.end(), caps_name.begin(), ::toupper);
             std::replace(caps_name.begin(), caps_name.end(), '.', '_');
 
@@ -84,14 +92,14 @@ void print_variable_data() {
                     os << "\\0";
                     if ((i % 4) == 3) {
                         os << "\",\n";
-                        std::cout << os.str();
+                        out << os.str();
                         os.str("");
                         os << caps_name << "_" << std::setw(4) << (i + 1) << ": .ascii \"";
                     }
                 }
                 else os << "\\x" << std::setw(2) << (int)(0xFF & data[i]);
             }
-            std::cout << os.str() << "\"\n\n\n";
+            out << os.str() << "\"\n\n\n";
 
             {
             // std::cout << "unsigned char " << section.name.substr(1);
@@ -123,27 +131,55 @@ void print_variable_data() {
     }
 }
 
-void print_formatted_assembly(unsigned int idx) {
+// decodes a section in the modes given by its $a/$t mapping symbols, or
+// by its function symbols when it has none
+arm_disassembly decode_section(const elf_object::section_t& section) {
+    thread_local arm_disassembler disassembler;
+    disassembler.memoize(memoize);
+    std::vector<arm_mapping> mapping;
+    for (const auto* symbol : section.symbols) {
+        char type = arm_mapping_type(symbol->name);
+        if (type != 0) mapping.push_back({ symbol->value, type });
+    }
+    if (mapping.size() == 0) {
+        for (const auto* symbol : section.symbols) {
+            if (symbol->type != elf_object::sym_type_t::FUNCTION) continue;
+            mapping.push_back({ symbol->value & ~1u, (symbol->value & 1) ? 't' : 'a' });
+        }
+    }
+    std::stable_sort(mapping.begin(), mapping.end(),
+    [](const arm_mapping& a, const arm_mapping& b) { return a.address < b.address; });
+
+    std::vector<size_t> first;
+    arm_disassembler::span range = { section.raw_data.data(), section.raw_data.size(), 0,
+        mapping.data(), mapping.size() };
+    return cache.decode(disassembler, { range }, first);
+}
+
+void print_formatted_assembly(const elf_object& obj, unsigned int idx, std::ostream& out) {
     struct function_t {
         std::string name;
         unsigned int offset;
+        size_t first; // index of code[0] in records
         std::vector<std::string> code;
+        std::vector<std::string> labels; // label ahead of code[i], if any
     };
 
     const elf_object::section_t& section = obj.sections()[idx];
     if (section.raw_data.size() == 0) return;
-    auto instructions = disassemble2array(section.raw_data);
+    auto records = decode_section(section);
+    auto instructions = records.lines(0, records.instructions.size());
 
     //
     // Comment relocation symbols
     //
 
     std::vector<std::string> leftovers;
-    for (const auto& reloc : obj.relocations()) {
-        if (reloc.sidx != idx) continue;
+    for (auto r : section.relocation_indices) {
+        const auto& reloc = obj.relocations()[r];
         if (reloc.symbol->name.size() == 0) continue;
         std::ostringstream os;
-        auto k = reloc.offset >> 2;
+        auto k = records.find(reloc.offset);
         os << " @ " << reloc.symbol->name;
         os << " [" << elf_object::reloc_type_string(reloc.type) << ": ";
         os << (reloc.symbol->section ? reloc.symbol->section->name : "") << "+";
@@ -201,13 +237,17 @@ void print_formatted_assembly(unsigned int idx) {
     // apply select relocation symbols
     //
 
-    for (const auto& reloc : obj.relocations()) {
-        if (reloc.sidx != idx) continue;
+    std::vector<bool> called(instructions.size(), false); // call named by its reloc
+    for (auto r : section.relocation_indices) {
+        const auto& reloc = obj.relocations()[r];
         if (reloc.symbol->name.size() == 0) continue;
-        auto k = reloc.offset >> 2;
+        auto k = records.find(reloc.offset);
         std::ostringstream os;
         if (k >= instructions.size()) continue;
-        if (reloc.type == elf_object::reloc_type_t::R_ARM_CALL) {
+        if (reloc.type == elf_object::reloc_type_t::R_ARM_CALL ||
+            reloc.type == elf_object::reloc_type_t::R_ARM_THM_CALL ||
+            reloc.type == elf_object::reloc_type_t::R_ARM_THM_JUMP24) {
+            called[k] = true;
             try {
                 std::istringstream iss(instructions[k]);
                 std::vector<std::string> tokens(
@@ -231,7 +271,7 @@ void print_formatted_assembly(unsigned int idx) {
                 std::istream_iterator<std::string>());
             const auto& str = tokens[0];
             if (str[0] == 'M' && str[1] == 'O' && str[2] == 'V') {
-                auto caps_name = reloc.symbol->section->name;
+                std::string caps_name(reloc.symbol->section->name);
                 std::transform(caps_name.begin(), caps_name.end(), caps_name.begin(), ::toupper);
                 std::replace(caps_name.begin(), caps_name.end(), '.', '_');
                 os << std::setw(12) << std::left << "ADDRL" << std::right;
@@ -257,19 +297,38 @@ void print_formatted_assembly(unsigned int idx) {
         std::vector<std::string> tokens(
             std::istream_iterator<std::string>{iss},
             std::istream_iterator<std::string>());
+        if (tokens.size() == 0) continue;
         const auto& ins = tokens[0];
         if (ins.size() >= 3 && ins[0] == 'L' && ins[1] == 'D' && ins[2] == 'R') {
-            auto& t = tokens[2];
-            if (t[0] == '[' && t[1] == 'P' && t[2] == 'C' && t[3] == ',') {
+            // "[PC, #n]", or "[PC]" for a zero offset; the comment holds
+            // the literal's address, in parentheses in Thumb code.
+            // Post-indexed "[PC], #n" and register offsets are not literals
+            bool literal =
+                (tokens.size() >= 4 && tokens[2] == "[PC," &&
+                 tokens[3][0] == '#' && tokens[3].back() == ']') ||
+                (tokens.size() >= 3 && tokens[2] == "[PC]" &&
+                 (tokens.size() == 3 || tokens[3][0] == '@'));
+            if (literal) {
                 std::ostringstream os;
                 try {
-                    const auto& addr = tokens[tokens.size() - 1];
-                    size_t k = std::stoul(addr, nullptr, 16) >> 2;
+                    std::string addr = tokens[tokens.size() - 1];
+                    if (addr.front() == '(' && addr.back() == ')')
+                        addr = addr.substr(1, addr.size() - 2);
+                    uint32_t literal = std::stoul(addr, nullptr, 16);
+                    size_t k = records.find(literal);
                     if (k >= instructions.size()) continue;
+                    // the literal's record may be a .short or .byte at the
+                    // end of a $d run, so print it at its own size
+                    const auto& data = records.instructions[k];
+                    if (data.address != literal) continue;
+                    uint32_t word = data.word;
+                    if (data.size == 4 && (data.flags & ARM_INSN_THUMB))
+                        word = (word >> 16) | (word << 16);
                     os << "WORD_" << addr.substr(addr.size() - 4);
                     std::string label = os.str();
-                    os << ": .word 0x" << std::hex << std::setfill('0') << std::setw(8);
-                    os << *(uint32_t*)&section.raw_data[k << 2] << std::setfill(' ');
+                    os << (data.size == 4 ? ": .word 0x" : data.size == 2 ? ": .short 0x" : ": .byte 0x");
+                    os << std::hex << std::setfill('0') << std::setw(data.size * 2);
+                    os << word << std::setfill(' ');
                     instructions[k] = os.str();
                     os.str("");
                     os << std::setw(12) << std::left << tokens[0] << std::right;
@@ -279,22 +338,22 @@ void print_formatted_assembly(unsigned int idx) {
                 } catch (...) { }
             }
         }
-        else if (ins.size() >= 2 && ins[0] == 'B' && ins[1] == 'L') {
+        else if (ins.size() >= 2 && ins[0] == 'B' && ins[1] == 'L' && !called[i]) {
+            // the destination comes from the decoder; bit 0 of a function
+            // symbol only marks Thumb code
+            const auto& insn = records.instructions[i];
+            if (!(insn.flags & ARM_INSN_HAS_TARGET)) continue;
             std::ostringstream os;
-            try {
-                const auto& addr = tokens[tokens.size() - 1];
-                size_t offset = std::stoul(addr, nullptr, 16);
-                os << std::setw(12) << std::left << tokens[0] << std::right;
-                for (const auto* symbol : section.symbols) {
-                    if (symbol->type != elf_object::sym_type_t::FUNCTION) continue;
-                    if (offset == symbol->value) {
-                        os << symbol->name << " ";
-                        os << std::setw(42 - os.str().size()) << "@ " << instructions[i];
-                        instructions[i] = os.str();
-                        break;
-                    }
+            os << std::setw(12) << std::left << tokens[0] << std::right;
+            for (const auto* symbol : section.symbols) {
+                if (symbol->type != elf_object::sym_type_t::FUNCTION) continue;
+                if (insn.target == (symbol->value & ~1u)) {
+                    os << symbol->name << " ";
+                    os << std::setw(42 - os.str().size()) << "@ " << instructions[i];
+                    instructions[i] = os.str();
+                    break;
                 }
-            } catch (...) { }
+            }
         }
     }
 
@@ -307,11 +366,15 @@ void print_formatted_assembly(unsigned int idx) {
         if (symbol->type != elf_object::sym_type_t::FUNCTION) continue;
         function_t function;
         function.name = symbol->name;
-        function.offset = symbol->value;
+        function.offset = symbol->value & ~1u; // bit 0 marks Thumb
+        function.first = records.find(function.offset);
+        size_t last = function.first;
+        if (symbol->size != 0)
+            last = std::min(records.find(function.offset + symbol->size - 1) + 1, instructions.size());
         function.code.insert(
             function.code.end(),
-            instructions.begin() + (symbol->value >> 2),
-            instructions.begin() + ((symbol->value + symbol->size) >> 2)
+            instructions.begin() + function.first,
+            instructions.begin() + std::max(function.first, last)
         );
         functions.push_back(function);
     }
@@ -330,8 +393,10 @@ void print_formatted_assembly(unsigned int idx) {
     //
 
     for (auto& function : functions) {
-        std::set<std::pair<unsigned int,std::string>> labels;
-        for (auto& instruction : function.code) {
+        function.labels.resize(function.code.size());
+        size_t first = function.first;
+        for (size_t i = 0; i < function.code.size(); i++) {
+            auto& instruction = function.code[i];
             if (instruction[0] != 'B') continue;
             char c1 = instruction[1];
             char c2 = instruction[2];
@@ -347,18 +412,21 @@ void print_formatted_assembly(unsigned int idx) {
                 (c1 == 'G' && (c2 == 'E'  || c2 == 'T')) ||
                 (c1 == 'A' &&  c2 == 'L'))
             {
+                // the destination comes from the decoder, not the text
+                const auto& insn = records.instructions[first + i];
+                if (!(insn.flags & ARM_INSN_HAS_TARGET)) continue;
+                unsigned int offset = insn.target;
+                size_t target = records.find(offset, first, first + function.code.size());
+                if (target == first + function.code.size() ||
+                    records.instructions[target].address != offset)
+                    continue;
+
                 std::istringstream iss(instruction);
                 std::ostringstream label;
                 std::ostringstream oss;
                 std::vector<std::string> tokens(
                     std::istream_iterator<std::string>{iss},
                     std::istream_iterator<std::string>());
-                if (tokens.size() < 2) continue;
-                if (tokens[1].size() < 3 || (tokens[1][0] != '0' && tokens[1][1] != 'x')) continue;
-                unsigned int offset = std::strtoul(tokens[1].data(), 0, 16);
-                if (offset <   function.offset ||
-                    offset >= (function.offset + (function.code.size() << 2)))
-                    continue;
                 label << function.name << "_x" << std::hex << offset;
                 oss << std::setw(12) << std::left << tokens[0] << std::right << label.str();
                 for (size_t j = 2; j < tokens.size(); j++) {
@@ -367,126 +435,158 @@ void print_formatted_assembly(unsigned int idx) {
                     else oss << tokens[j] << " ";
                 }
                 instruction = oss.str();
-                labels.insert(std::pair<unsigned int, std::string>(
-                    (offset - function.offset) >> 2, label.str()));
+                function.labels[target - first] = label.str();
             }
         }
-        std::for_each(labels.rbegin(), labels.rend(), [&](const std::pair<unsigned int,std::string>& label) {
-            // assume label within function bounds
-            function.code.insert(function.code.begin() + label.first, label.second + ":");
-        });
     }
 
     //
     // print section info
     //
 
-    std::cout << "@ - - - - - - - - - - - - - - - - - - - - - - - - - - - - - \n";
-    std::cout << "@ " << section.name << "\n";
-    std::cout << "@ Size: 0x" << std::hex << section.raw_data.size() << std::dec << "\n";
-    std::cout << "@ - - - - - - - - - - - - - - - - - - - - - - - - - - - - - \n\n";
+    out << "@ - - - - - - - - - - - - - - - - - - - - - - - - - - - - - \n";
+    out << "@ " << section.name << "\n";
+    out << "@ Size: 0x" << std::hex << section.raw_data.size() << std::dec << "\n";
+    out << "@ - - - - - - - - - - - - - - - - - - - - - - - - - - - - - \n\n";
 
     //
     // print formatted functions
     //
 
-    std::cout << std::hex << std::setfill('0');
+    out << std::hex << std::setfill('0');
     for (const auto& function : functions) {
-        std::cout << "FUNC_BEGIN " << function.name << "\n";
-        for (size_t i = 0, j = 0; i < function.code.size(); i++, j++) {
-            const auto& code = function.code[i];
-            if (code[code.size() - 1] != ':')
-                std::cout << "    /*" << std::setw(8) << (function.offset + (j << 2)) << "*/ ";
-            else {
-                std::cout << "    ";
-                j--;
-            }
-            std::cout << code << "\n";
+        out << "FUNC_BEGIN " << function.name << "\n";
+        for (size_t i = 0; i < function.code.size(); i++) {
+            if (!function.labels[i].empty())
+                out << "    " << function.labels[i] << ":\n";
+            out << "    /*" << std::setw(8) << records.instructions[function.first + i].address << "*/ ";
+            out << function.code[i] << "\n";
         }
-        std::cout << "FUNC_END " << function.name << "\n\n\n";
+        out << "FUNC_END " << function.name << "\n\n\n";
     }
-    std::cout << std::dec << std::setfill(' ');
+    out << std::dec << std::setfill(' ');
 
     // if (leftovers.size() > 0) {
-    //     std::cout << "@ -- Leftover Relocations --\n\n";
+    //     out << "@ -- Leftover Relocations --\n\n";
     //     for (const auto& token : leftovers)
-    //         std::cout << token << "\n";
-    //     std::cout << "\n\n";
+    //         out << token << "\n";
+    //     out << "\n\n";
     // }
 }
 
-void print_formatted_c(unsigned int idx) {
+// a decoded line split into blank-separated words, with ';' comments
+// turned into '@' ones and everything ahead of the first '@' uppercased
+// (except the x of a 0x prefix)
+std::vector<std::string> code_tokens(std::string_view line, std::string_view notes) {
+    std::vector<std::string> tokens;
+    for (auto text : { line, notes }) {
+        size_t k = 0;
+        while (k < text.size()) {
+            while (k < text.size() && std::isspace((unsigned char)text[k])) k++;
+            size_t start = k;
+            while (k < text.size() && !std::isspace((unsigned char)text[k])) k++;
+            if (k > start) tokens.emplace_back(text.substr(start, k - start));
+        }
+    }
+
+    bool code = true;
+    for (auto& token : tokens) {
+        std::replace(token.begin(), token.end(), ';', '@');
+        for (size_t k = 0; code && k < token.size(); k++) {
+            if (token[k] == 'x') {
+                if (k == 0 || token[k - 1] != '0')
+                    token[k] = 'X';
+            }
+            else if (token[k] == '@') code = false;
+            else token[k] = std::toupper(token[k]);
+        }
+    }
+    return tokens;
+}
+
+// code_tokens() laid out in the columns print_formatted_c prints
+std::string format_tokens(const std::vector<std::string>& tokens) {
+    if (tokens.size() == 0) return "";
+    std::ostringstream os;
+    os << std::setw(12) << std::left << tokens[0] << std::right;
+    for (size_t j = 1; j < tokens.size(); j++) {
+        // comments
+        if (tokens[j][0] == '@')
+            os << std::setw(42 - os.str().size()) << "@ ";
+        // arguments
+        else os << tokens[j] << " ";
+    }
+    return os.str();
+}
+
+// a record's "\t; ..." comment and its relocation notes as the words
+// to_c() appends, split at blanks and commas, each ';' or '@' word as "@"
+std::string code_comments(std::string_view comment, std::string_view notes) {
+    std::string comments;
+    for (auto text : { comment, notes }) {
+        size_t k = 0;
+        while (k < text.size()) {
+            while (k < text.size() && (text[k] == ',' || std::isspace((unsigned char)text[k]))) k++;
+            size_t start = k;
+            while (k < text.size() && text[k] != ',' && !std::isspace((unsigned char)text[k])) k++;
+            if (k == start) break;
+            if (!comments.empty()) comments += ' ';
+            if (text[start] == ';' || text[start] == '@') comments += '@';
+            else comments.append(text.substr(start, k - start));
+        }
+    }
+    return comments;
+}
+
+int print_formatted_c(const elf_object& obj, unsigned int idx, std::ostream& out) {
+    struct line_t {
+        std::vector<std::string> tokens; // see code_tokens()
+        std::string text;                // format_tokens(tokens)
+        std::string label;               // the branch target's, if any
+    };
     struct function_t {
         std::string name;
         unsigned int offset;
-        std::vector<std::string> code;
+        size_t first; // index of code[0] in records
+        std::vector<line_t> code;
+        std::vector<std::string> labels; // label ahead of code[i], if any
     };
 
     const elf_object::section_t& section = obj.sections()[idx];
-    if (section.raw_data.size() == 0) return;
-    auto instructions = disassemble2array(section.raw_data);
+    if (section.raw_data.size() == 0) return 0;
+    auto records = decode_section(section);
+    size_t count = records.instructions.size();
 
     //
     // Apply relocation symbols
     //
 
     std::vector<std::string> leftovers;
-    for (const auto& reloc : obj.relocations()) {
-        if (reloc.sidx != idx) continue;
+    std::vector<std::string> notes(count);
+    for (auto r : section.relocation_indices) {
+        const auto& reloc = obj.relocations()[r];
         if (reloc.symbol->name.size() == 0) continue;
         std::ostringstream os;
-        auto idx = reloc.offset >> 2;
+        auto idx = records.find(reloc.offset);
         os << " @ " << reloc.symbol->name;
         os << " [" << elf_object::reloc_type_string(reloc.type) << ": ";
         os << (reloc.symbol->section ? reloc.symbol->section->name : "") << "+";
         os << "0x" << std::hex << reloc.symbol->value << "]";
-        if (idx >= instructions.size()) {
+        if (idx >= count) {
             os << " 0x" << reloc.offset;
             leftovers.push_back(os.str());
         }
-        else instructions[idx] += os.str();
+        else notes[idx] += os.str();
     }
 
     //
     // Format Instructions
     //
 
-    for (size_t i = 0; i < instructions.size(); i++) {
-        std::replace(instructions[i].begin(), instructions[i].end(), ';', '@');
-        std::replace(instructions[i].begin(), instructions[i].end(), '\t', ' ');
-
-        std::istringstream iss(instructions[i]);
-        std::vector<std::string> tokens(
-            std::istream_iterator<std::string>{iss},
-            std::istream_iterator<std::string>());
-        if (tokens.size() == 0) continue;
-
-        std::ostringstream os;
-
-        // instruction
-        os << std::setw(12) << std::left << tokens[0] << std::right;
-
-        for (size_t j = 1; j < tokens.size(); j++) {
-            // comments
-            if (tokens[j][0] == '@')
-                os << std::setw(42 - os.str().size()) << "@ ";
-            // arguments
-            else os << tokens[j] << " ";
-        }
-        instructions[i] = os.str();
-
-        // to uppercase
-        auto k = instructions[i].find_first_of("@");
-        std::string::iterator end = (k != std::string::npos) ?
-            instructions[i].begin() + k : instructions[i].end();
-        for (size_t k = 0; k < instructions[i].size(); k++) {
-            if (instructions[i][k] == 'x') {
-                if (k == 0 || instructions[i][k - 1] != '0')
-                    instructions[i][k] = 'X';
-            }
-            else if (instructions[i][k] == '@') break;
-            else instructions[i][k] = std::toupper(instructions[i][k]);
-        }
+    std::vector<line_t> instructions(count);
+    for (size_t i = 0; i < count; i++) {
+        instructions[i].tokens = code_tokens(records.line(i), notes[i]);
+        instructions[i].text = format_tokens(instructions[i].tokens);
     }
 
     //
@@ -498,11 +598,15 @@ void print_formatted_c(unsigned int idx) {
         if (symbol->type != elf_object::sym_type_t::FUNCTION) continue;
         function_t function;
         function.name = symbol->name;
-        function.offset = symbol->value;
+        function.offset = symbol->value & ~1u; // bit 0 marks Thumb
+        function.first = records.find(function.offset);
+        size_t last = function.first;
+        if (symbol->size != 0)
+            last = std::min(records.find(function.offset + symbol->size - 1) + 1, count);
         function.code.insert(
             function.code.end(),
-            instructions.begin() + (symbol->value >> 2),
-            instructions.begin() + ((symbol->value + symbol->size) >> 2)
+            instructions.begin() + function.first,
+            instructions.begin() + std::max(function.first, last)
         );
         functions.push_back(function);
     }
@@ -521,8 +625,11 @@ void print_formatted_c(unsigned int idx) {
     //
 
     for (auto& function : functions) {
-        std::set<std::pair<unsigned int,std::string>> labels;
-        for (auto& instruction : function.code) {
+        function.labels.resize(function.code.size());
+        size_t first = function.first;
+        for (size_t i = 0; i < function.code.size(); i++) {
+            auto& line = function.code[i];
+            const auto& instruction = line.text;
             if (instruction[0] != 'B') continue;
             char c1 = instruction[1];
             char c2 = instruction[2];
@@ -538,74 +645,69 @@ void print_formatted_c(unsigned int idx) {
                 (c1 == 'G' && (c2 == 'E'  || c2 == 'T')) ||
                 (c1 == 'A' &&  c2 == 'L'))
             {
-                std::istringstream iss(instruction);
-                std::ostringstream label;
-                std::ostringstream oss;
-                std::vector<std::string> tokens(
-                    std::istream_iterator<std::string>{iss},
-                    std::istream_iterator<std::string>());
-                if (tokens.size() < 2) continue;
-                if (tokens[1].size() < 3 || (tokens[1][0] != '0' && tokens[1][1] != 'x')) continue;
-                unsigned int offset = std::strtoul(tokens[1].data(), 0, 16);
-                if (offset <   function.offset ||
-                    offset >= (function.offset + (function.code.size() << 2)))
+                // the destination comes from the decoder, not the text
+                const auto& insn = records.instructions[first + i];
+                if (!(insn.flags & ARM_INSN_HAS_TARGET)) continue;
+                unsigned int offset = insn.target;
+                size_t target = records.find(offset, first, first + function.code.size());
+                if (target == first + function.code.size() ||
+                    records.instructions[target].address != offset)
                     continue;
+
+                std::ostringstream label;
                 label << function.name << "_x" << std::hex << offset;
-                oss << std::setw(12) << std::left << tokens[0] << std::right << label.str();
-                for (size_t j = 2; j < tokens.size(); j++) {
-                    if (tokens[j][0] == '@')
-                        oss << std::setw(42 - oss.str().size()) << "@ ";
-                    else oss << tokens[j] << " ";
-                }
-                instruction = oss.str();
-                labels.insert(std::pair<unsigned int, std::string>(
-                    (offset - function.offset) >> 2, label.str()));
+                if (line.tokens.size() < 2) line.tokens.resize(2);
+                line.tokens[1] = label.str();
+                line.text = format_tokens(line.tokens);
+                line.label = label.str();
+                function.labels[target - first] = label.str();
             }
         }
-        std::for_each(labels.rbegin(), labels.rend(), [&](const std::pair<unsigned int,std::string>& label) {
-            // assume label within function bounds
-            function.code.insert(function.code.begin() + label.first, label.second + ":");
-        });
     }
 
     //
     // print section info
     //
 
-    std::cout << "// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - \n";
-    std::cout << "// " << section.name << "\n";
-    std::cout << "// Size: 0x" << std::hex << section.raw_data.size() << std::dec << "\n";
-    std::cout << "// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - \n\n";
+    out << "// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - \n";
+    out << "// " << section.name << "\n";
+    out << "// Size: 0x" << std::hex << section.raw_data.size() << std::dec << "\n";
+    out << "// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - \n\n";
 
     //
     // print formatted functions
     //
 
-    std::cout << std::hex << std::setfill('0');
+    out << std::hex << std::setfill('0');
     for (const auto& function : functions) {
-        std::cout << "uint32_t " << function.name << "() {\n";
-        for (size_t i = 0, j = 0; i < function.code.size(); i++, j++) {
-            const auto& code = function.code[i];
-            if (code[0] == '@') std::cout << "    // " << code << "\n";
-            else if (code[code.size() - 1] != ':') {
-                // std::cout << "    /*" << std::setw(8) << (function.offset + (j << 2)) << "*/ ";
+        out << "uint32_t " << function.name << "() {\n";
+        for (size_t i = 0; i < function.code.size(); i++) {
+            const auto& code = function.code[i].text;
+            if (!function.labels[i].empty())
+                out << "  " << function.labels[i] << ":\n";
+            bool is_data = records.instructions[function.first + i].flags & ARM_INSN_DATA;
+            if (code[0] == '@' || is_data) out << "    // " << code << "\n";
+            else {
+                // std::cout << "    /*" << std::setw(8) << records.instructions[function.first + i].address << "*/ ";
                 try {
-                    auto ins = instruction_t::parse(code);
-                    std::cout << "    " << ins.to_c() << "\n";
+                    size_t index = function.first + i;
+                    std::string original = code;
+                    std::replace(original.begin(), original.end(), ',', ' ');
+                    auto ins = instruction_t::from_record(
+                        records, index,
+                        code_comments(records.comment(index), notes[index]),
+                        original, function.code[i].label);
+                    out << "    " << ins.to_c() << "\n";
                 } catch (std::runtime_error& e) {
-                    std::cout << "Error converting instruction \"" << code << "\" to C\n";
-                    std::cout << e.what() << std::endl;
-                    exit(1);
+                    out << "Error converting instruction \"" << code << "\" to C\n";
+                    out << e.what() << std::endl;
+                    return 1;
                 }
             }
-            else {
-                std::cout << "  " << code << "\n";
-                j--;
-            }
         }
-        std::cout << "}\n\n\n";
+        out << "}\n\n\n";
     }
-    std::cout << std::dec << std::setfill(' ');
+    out << std::dec << std::setfill(' ');
 
     // if (leftovers.size() > 0) {
     //     std::cout << "@ -- Leftover Relocations --\n\n";
@@ -613,74 +715,88 @@ void print_formatted_c(unsigned int idx) {
     //         std::cout << token << "\n";
     //     std::cout << "\n\n";
     // }
+
+    return 0;
 }
 
-void disassemble() {
-    print_variable_data();
+void disassemble(const elf_object& obj, std::ostream& out, unsigned int threads) {
+    print_variable_data(obj, out);
 
+    std::vector<unsigned int> text_sections;
     const auto& sections = obj.sections();
     for (size_t i = 0; i < sections.size(); i++) {
         if (sections[i].type == elf_object::section_type_t::PROGBITS &&
             sections[i].name.rfind(".text") != sections[i].name.npos)
-            print_formatted_assembly(i);
+            text_sections.push_back(i);
     }
+
+    // sections are formatted independently, then printed in section order
+    std::vector<std::string> output(text_sections.size());
+    parallel_for(text_sections.size(), [&](size_t k) {
+        std::ostringstream os;
+        print_formatted_assembly(obj, text_sections[k], os);
+        output[k] = os.str();
+    }, threads);
+    for (const auto& text : output)
+        out << text;
 }
 
-void decompile() {
-    print_variable_data();
+int decompile(const elf_object& obj, std::ostream& out) {
+    print_variable_data(obj, out);
 
     const auto& sections = obj.sections();
     for (size_t i = 0; i < sections.size(); i++) {
         if (sections[i].type == elf_object::section_type_t::PROGBITS &&
             sections[i].name.rfind(".text") != sections[i].name.npos)
-            print_formatted_c(i);
+            if (print_formatted_c(obj, i, out) != 0) return 1;
     }
+    return 0;
 }
 
-void print_header() {
-    std::cout << std::hex;
-    std::cout << "==========================\n";
-    std::cout << "==      ELF HEADER      ==\n";
-    std::cout << "==========================\n\n";
-    std::cout << "Identity: "  << obj.id()      << "\n";
-    std::cout << "Type: "      << obj.type()    << "\n";
-    std::cout << "Machine: "   << obj.machine() << "\n";
-    std::cout << "Version: 0x" << obj.version() << "\n";
-    std::cout << "Entry: 0x"   << obj.entry()   << "\n";
-    std::cout << "Flags: 0x"   << obj.flags()   << "\n";
-    std::cout << "ELF Header Size: 0x"                   << obj.elf_header_size()                 << "\n";
-    std::cout << "Section Header String Table Index: 0x" << obj.string_table_index()              << "\n";
-    std::cout << "Section Header Table's Offset: 0x"     << obj.section_header_info().offset      << "\n";
-    std::cout << "Section Header Table Entry Size: 0x"   << obj.section_header_info().entry_size  << "\n";
-    std::cout << "Section Header Table Entry Count: 0x"  << obj.section_header_info().entry_count << "\n";
-    std::cout << "Program Header Table's Offset: 0x"     << obj.program_header_info().offset      << "\n";
-    std::cout << "Program Header Table Entry Size: 0x"   << obj.program_header_info().entry_size  << "\n";
-    std::cout << "Program Header Table Entry Count: 0x"  << obj.program_header_info().entry_count << "\n";
-    std::cout << std::dec << std::endl;
+void print_header(const elf_object& obj, std::ostream& out) {
+    out << std::hex;
+    out << "==========================\n";
+    out << "==      ELF HEADER      ==\n";
+    out << "==========================\n\n";
+    out << "Identity: "  << obj.id()      << "\n";
+    out << "Type: "      << obj.type()    << "\n";
+    out << "Machine: "   << obj.machine() << "\n";
+    out << "Version: 0x" << obj.version() << "\n";
+    out << "Entry: 0x"   << obj.entry()   << "\n";
+    out << "Flags: 0x"   << obj.flags()   << "\n";
+    out << "ELF Header Size: 0x"                   << obj.elf_header_size()                 << "\n";
+    out << "Section Header String Table Index: 0x" << obj.string_table_index()              << "\n";
+    out << "Section Header Table's Offset: 0x"     << obj.section_header_info().offset      << "\n";
+    out << "Section Header Table Entry Size: 0x"   << obj.section_header_info().entry_size  << "\n";
+    out << "Section Header Table Entry Count: 0x"  << obj.section_header_info().entry_count << "\n";
+    out << "Program Header Table's Offset: 0x"     << obj.program_header_info().offset      << "\n";
+    out << "Program Header Table Entry Size: 0x"   << obj.program_header_info().entry_size  << "\n";
+    out << "Program Header Table Entry Count: 0x"  << obj.program_header_info().entry_count << "\n";
+    out << std::dec << std::endl;
 }
 
-void print_sections() {
+void print_sections(const elf_object& obj, std::ostream& out) {
     const auto& sections = obj.sections();
     unsigned int index = 0;
-    std::cout << std::hex;
-    std::cout << "===============================\n";
-    std::cout << "==      SECTION HEADERS      ==\n";
-    std::cout << "===============================\n\n";
-    std::cout << "Index | Name                           | ";
-    std::cout << "Type                      | ";
-    std::cout << "Flags    | Address  | Offset   | Size     | Link     | ";
-    std::cout << "Info     | Align    | Entry Size \n";
-    std::cout << "--------------------------------------------------";
-    std::cout << "--------------------------------------------------";
-    std::cout << "------------------------------------------------------------\n";
+    out << std::hex;
+    out << "===============================\n";
+    out << "==      SECTION HEADERS      ==\n";
+    out << "===============================\n\n";
+    out << "Index | Name                           | ";
+    out << "Type                      | ";
+    out << "Flags    | Address  | Offset   | Size     | Link     | ";
+    out << "Info     | Align    | Entry Size \n";
+    out << "--------------------------------------------------";
+    out << "--------------------------------------------------";
+    out << "------------------------------------------------------------\n";
     for (const auto& section : sections) {
-        std::cout << std::setw(5) << index++ << "   ";
-        std::cout << std::setw(30) << section.name << "   ";
-        std::cout << std::setw(25) << elf_object::section_type_string(section.type).substr(0, 25) << "   ";
-        std::cout << std::setw( 8) << elf_object::section_flags_string(section.flags) << "   ";
-        std::cout << std::setw( 8) << section.address    << "   ";
-        std::cout << std::setw( 8) << section.offset     << "   ";
-        std::cout << std::setw( 8) << section.size       << "   ";
+        out << std::setw(5) << index++ << "   ";
+        out << std::setw(30) << section.name << "   ";
+        out << std::setw(25) << elf_object::section_type_string(section.type).substr(0, 25) << "   ";
+        out << std::setw( 8) << elf_object::section_flags_string(section.flags) << "   ";
+        out << std::setw( 8) << section.address    << "   ";
+        out << std::setw( 8) << section.offset     << "   ";
+        out << std::setw( 8) << section.size       << "   ";
 
         unsigned int link;
         for (size_t k = 0; k < sections.size(); k++) {
@@ -690,50 +806,50 @@ void print_sections() {
             }
         }
 
-        std::cout << std::setw( 8) << link               << "   ";
-        std::cout << std::setw( 8) << section.info       << "   ";
-        std::cout << std::setw( 8) << section.align      << "   ";
-        std::cout << std::setw( 8) << section.entry_size << "   ";
-        std::cout << "\n";
+        out << std::setw( 8) << link               << "   ";
+        out << std::setw( 8) << section.info       << "   ";
+        out << std::setw( 8) << section.align      << "   ";
+        out << std::setw( 8) << section.entry_size << "   ";
+        out << "\n";
     }
-    std::cout << "--------------------------------------------------";
-    std::cout << "--------------------------------------------------";
-    std::cout << "------------------------------------------------------------\n";
-    std::cout << std::dec << std::endl;
+    out << "--------------------------------------------------";
+    out << "--------------------------------------------------";
+    out << "------------------------------------------------------------\n";
+    out << std::dec << std::endl;
 }
 
-void print_symbols() {
+void print_symbols(const elf_object& obj, std::ostream& out) {
     const auto& symbols = obj.symbols();
     const auto& sections = obj.sections();
     unsigned int count = 0;
     if (symbols.size() == 0) return;
-    std::cout << std::hex;
-    std::cout << "=======================\n";
-    std::cout << "==      SYMBOLS      ==\n";
-    std::cout << "=======================\n\n";
-    std::cout << "Index | Value    | Size     | Bind    | Type    | Other | Section | ";
-    std::cout << "Name                                \n";
-    std::cout << "--------------------------------------------------";
-    std::cout << "--------------------------------------------------\n";
+    out << std::hex;
+    out << "=======================\n";
+    out << "==      SYMBOLS      ==\n";
+    out << "=======================\n\n";
+    out << "Index | Value    | Size     | Bind    | Type    | Other | Section | ";
+    out << "Name                                \n";
+    out << "--------------------------------------------------";
+    out << "--------------------------------------------------\n";
     for (const auto& symbol : symbols) {
-        std::cout << std::setw(5) << count         << "   ";
-        std::cout << std::setw(8) << symbol.value  << "   ";
-        std::cout << std::setw(8) << symbol.size   << "   ";
-        std::cout << std::setw(7);
+        out << std::setw(5) << count         << "   ";
+        out << std::setw(8) << symbol.value  << "   ";
+        out << std::setw(8) << symbol.size   << "   ";
+        out << std::setw(7);
         switch (symbol.bind) {
-        case elf_object::sym_bind_t::LOCAL:    std::cout << "LOCAL";   break;
-        case elf_object::sym_bind_t::GLOBAL:   std::cout << "GLOBAL";  break;
-        case elf_object::sym_bind_t::WEAK:     std::cout << "WEAK";    break;
-        default:                               std::cout << "UNKNOWN"; break;
+        case elf_object::sym_bind_t::LOCAL:    out << "LOCAL";   break;
+        case elf_object::sym_bind_t::GLOBAL:   out << "GLOBAL";  break;
+        case elf_object::sym_bind_t::WEAK:     out << "WEAK";    break;
+        default:                               out << "UNKNOWN"; break;
         }
-        std::cout << "   " << std::setw(7);
+        out << "   " << std::setw(7);
         switch (symbol.type) {
-        case elf_object::sym_type_t::NOTYPE:   std::cout << "NOTYPE";  break;
-        case elf_object::sym_type_t::OBJECT:   std::cout << "OBJECT";  break;
-        case elf_object::sym_type_t::FUNCTION: std::cout << "FUNC";    break;
-        case elf_object::sym_type_t::SECTION:  std::cout << "SECTION"; break;
-        case elf_object::sym_type_t::FILE:     std::cout << "FILE";    break;
-        default:                               std::cout << "UNKNOWN"; break;
+        case elf_object::sym_type_t::NOTYPE:   out << "NOTYPE";  break;
+        case elf_object::sym_type_t::OBJECT:   out << "OBJECT";  break;
+        case elf_object::sym_type_t::FUNCTION: out << "FUNC";    break;
+        case elf_object::sym_type_t::SECTION:  out << "SECTION"; break;
+        case elf_object::sym_type_t::FILE:     out << "FILE";    break;
+        default:                               out << "UNKNOWN"; break;
         }
         size_t sidx;
         for (size_t k = 0; k < sections.size(); k++) {
@@ -742,36 +858,36 @@ void print_symbols() {
                 break;
             }
         }
-        std::cout << "   ";
-        std::cout << std::setw(5) << (int)symbol.other << "   ";
-        std::cout << std::setw(7) << sidx << "   ";
-        std::cout << symbol.name << "\n";
-    }
-    std::cout << "--------------------------------------------------";
-    std::cout << "--------------------------------------------------\n";
-    std::cout << std::dec << std::endl;
+        out << "   ";
+        out << std::setw(5) << (int)symbol.other << "   ";
+        out << std::setw(7) << sidx << "   ";
+        out << symbol.name << "\n";
+    }
+    out << "--------------------------------------------------";
+    out << "--------------------------------------------------\n";
+    out << std::dec << std::endl;
 }
 
-void print_relocations() {
+void print_relocations(const elf_object& obj, std::ostream& out) {
     const auto& relocations = obj.relocations();
     const auto& sections = obj.sections();
     unsigned int count = 0;
     if (relocations.size() == 0) return;
-    std::cout << std::hex;
-    std::cout << "===========================\n";
-    std::cout << "==      RELOCATIONS      ==\n";
-    std::cout << "===========================\n\n";
-    std::cout << "Index | Offset   | Type                     | Symbol   \n";
-    std::cout << "--------------------------------------------------";
-    std::cout << "--------------------------------------------------\n";
+    out << std::hex;
+    out << "===========================\n";
+    out << "==      RELOCATIONS      ==\n";
+    out << "===========================\n\n";
+    out << "Index | Offset   | Type                     | Symbol   \n";
+    out << "--------------------------------------------------";
+    out << "--------------------------------------------------\n";
     for (const auto& section : obj.sections()) {
         if (section.type != elf_object::section_type_t::REL) continue;
-        std::cout << section.name << "\n__________\n";
+        out << section.name << "\n__________\n";
         const auto& relocs = obj.relocations();
         for (const auto k : section.entry_indices) {
-            std::cout << std::setw(5) << count++ << "   " << std::left;
-            std::cout << std::setw(8) << relocs[k].offset << "   ";
-            std::cout << std::setw(24) << elf_object::reloc_type_string(relocs[k].type) << "   ";
+            out << std::setw(5) << count++ << "   " << std::left;
+            out << std::setw(8) << relocs[k].offset << "   ";
+            out << std::setw(24) << elf_object::reloc_type_string(relocs[k].type) << "   ";
 
             std::string section_name;
             for (const auto& section : sections) {
@@ -784,34 +900,166 @@ void print_relocations() {
                 if (section_name.size() != 0) break;
             }
 
-            std::cout << relocs[k].symbol->name << " ";
-            std::cout << section_name << "@x" << relocs[k].symbol->value;
+            out << relocs[k].symbol->name << " ";
+            out << section_name << "@x" << relocs[k].symbol->value;
 
-            std::cout << "\n" << std::right;
+            out << "\n" << std::right;
         }
-        std::cout << "\n";
+        out << "\n";
     }
-    std::cout << "--------------------------------------------------";
-    std::cout << "--------------------------------------------------\n";
-    std::cout << std::dec << std::right << std::endl;
+    out << "--------------------------------------------------";
+    out << "--------------------------------------------------\n";
+    out << std::dec << std::right << std::endl;
 }
 
-void print() {
-    print_header();
-    print_sections();
-    print_symbols();
-    print_relocations();
+void print(const elf_object& obj, std::ostream& out) {
+    print_header(obj, out);
+    print_sections(obj, out);
+    print_symbols(obj, out);
+    print_relocations(obj, out);
+}
+
+enum class output_mode {
+    DISASSEMBLE,
+    DECOMPILE,
+    PRINT,
+    RELOCATIONS,
+    SECTIONS,
+    SYMBOLS
+};
+
+int convert(const std::string& filename, output_mode mode, std::ostream& out, unsigned int threads) {
+    elf_object obj;
+    if (read_elf_file(filename, obj, out) != 0)
+        return 1;
+
+    switch (mode) {
+    case output_mode::DECOMPILE:   return decompile(obj, out);
+    case output_mode::PRINT:       print(obj, out); break;
+    case output_mode::RELOCATIONS: print_relocations(obj, out); break;
+    case output_mode::SECTIONS:    print_sections(obj, out); break;
+    case output_mode::SYMBOLS:     print_symbols(obj, out); break;
+    default:                       disassemble(obj, out, threads); break;
+    }
+    return 0;
+}
+
+struct input_t {
+    std::string path;
+    std::string name; // relative name used for per-file output
+};
+
+// files are taken as given; directories are searched for *.o files
+std::vector<input_t> collect_inputs(const std::vector<std::string>& operands) {
+    namespace fs = std::filesystem;
+    std::vector<input_t> inputs;
+    for (const auto& operand : operands) {
+        std::error_code error;
+        if (!fs::is_directory(operand, error)) {
+            inputs.push_back({ operand, fs::path(operand).filename().string() });
+            continue;
+        }
+        std::vector<input_t> found;
+        for (const auto& entry : fs::recursive_directory_iterator(operand, error)) {
+            if (!entry.is_regular_file() || entry.path().extension() != ".o") continue;
+            found.push_back({ entry.path().string(),
+                entry.path().lexically_relative(operand).string() });
+        }
+        std::sort(found.begin(), found.end(),
+        [](const input_t& a, const input_t& b) { return a.path < b.path; });
+        inputs.insert(inputs.end(), found.begin(), found.end());
+    }
+    return inputs;
+}
+
+/**
+ * Converts many objects in one process. Files are handled concurrently,
+ * each with its own elf_object, and either written to <directory>/<name>
+ * plus an extension or printed to stdout in input order, each after a
+ * banner naming the file.
+ */
+int convert_batch(const std::vector<input_t>& inputs, output_mode mode, const std::string& directory, unsigned int threads) {
+    namespace fs = std::filesystem;
+    const char* extension =
+        mode == output_mode::DISASSEMBLE ? ".s" :
+        mode == output_mode::DECOMPILE   ? ".c" : ".txt";
+
+    // two inputs with the same name (d1/x.o and d2/x.o given as files)
+    // would overwrite each other's output; refuse before converting any
+    if (directory.size() != 0) {
+        std::map<std::string, const std::string*> written;
+        for (const auto& input : inputs) {
+            auto result = written.emplace(input.name, &input.path);
+            if (result.second) continue;
+            std::cerr << "Both " << *result.first->second << " and " << input.path
+                << " would be written to " << (fs::path(directory) / (input.name + extension)).string()
+                << std::endl;
+            return 1;
+        }
+    }
+
+    std::atomic<bool> failed(false);
+    std::vector<std::string> output(inputs.size());
+    std::vector<bool> done(inputs.size(), false);
+    size_t next = 0;
+    std::mutex print_lock;
+
+    parallel_for(inputs.size(), [&](size_t k) {
+        std::ostringstream os;
+        if (convert(inputs[k].path, mode, os, 1) != 0) failed = true;
+
+        if (directory.size() != 0) {
+            fs::path target = fs::path(directory) / (inputs[k].name + extension);
+            std::error_code error;
+            fs::create_directories(target.parent_path(), error);
+            std::ofstream file(target, std::ios::trunc);
+            if (!(file << os.str())) {
+                std::cerr << "Failed to write file " << target.string() << std::endl;
+                failed = true;
+            }
+            return;
+        }
+
+        // print each file as soon as every file before it has been printed
+        std::lock_guard<std::mutex> guard(print_lock);
+        output[k] = os.str();
+        done[k] = true;
+        for (; next < inputs.size() && done[next]; next++) {
+            std::cout << "@ ==== " << inputs[next].path << " ====\n\n";
+            std::cout << output[next];
+            std::string().swap(output[next]);
+        }
+    }, threads);
+
+    return failed ? 1 : 0;
+}
+
+// memo hit rate and decode throughput, for -m
+void print_decode_report(std::ostream& out) {
+    auto totals = arm_disassembler::totals();
+    uint64_t lookups = totals.memo_hits + totals.memo_misses;
+    double seconds = totals.nanoseconds / 1e9;
+    out << "decode memo: " << totals.memo_hits << " hits / " << lookups << " lookups ("
+        << std::fixed << std::setprecision(1)
+        << (lookups ? 100.0 * totals.memo_hits / lookups : 0.0) << "%); "
+        << totals.instructions << " records in " << (seconds * 1e3) << " ms ("
+        << (seconds > 0 ? totals.instructions / seconds / 1e6 : 0.0) << "M/s)\n";
 }
 
 void print_usage(const char* program_name, bool error = true) {
-    std::cout << "Usage: " << program_name << " [options] <elf-binary>\n";
+    std::cout << "Usage: " << program_name << " [options] <elf-binary|directory>...\n";
     std::cout << "Options:\n";
     std::cout << "\t-d\tdisassembly binary into near-compilable assembly\n";
     std::cout << "\t-p\tprint all\n";
     std::cout << "\t-r\tprint relocations\n";
     std::cout << "\t-s\tprint sections\n";
     std::cout << "\t-t\tprint symbols\n";
+    std::cout << "\t-j\tnumber of worker threads (default: one per core)\n";
+    std::cout << "\t-m\treuse the decode of repeated instruction words and report the hit rate\n";
+    std::cout << "\t-o\twith several inputs, write one output file per input into this directory\n";
     std::cout << "\t-h\tprint usage information\n";
+    std::cout << "Environment:\n";
+    std::cout << "\t" DECODE_CACHE_ENV "\tdirectory for cached section decodes\n";
     exit(error ? 1 : 0);
 }
 
@@ -821,25 +1069,42 @@ int main(int argc, char** argv) {
         return -1;
     }
 
-    if (read_elf_file(std::string(argv[argc - 1])) != 0)
-        return 1;
-
     int opt;
     bool to_c = false;
-    while((opt = getopt(argc, argv, "c:p:r:s:t:h")) != -1) {
+    bool chosen = false;
+    unsigned int jobs = 0;
+    std::string directory;
+    output_mode mode = output_mode::DISASSEMBLE;
+    auto choose = [&](output_mode m) { if (!chosen) mode = m; chosen = true; };
+    while((opt = getopt(argc, argv, "cj:mo:prsth")) != -1) {
         switch(opt) {
         case 'c': to_c = true; break;
-        case 'p': print(); return 0;
-        case 'r': print_relocations(); return 0;
-        case 's': print_sections(); return 0;
-        case 't': print_symbols(); return 0;
+        case 'j': jobs = std::strtoul(optarg, nullptr, 10); break;
+        case 'm': memoize = true; break;
+        case 'o': directory = optarg; break;
+        case 'p': choose(output_mode::PRINT); break;
+        case 'r': choose(output_mode::RELOCATIONS); break;
+        case 's': choose(output_mode::SECTIONS); break;
+        case 't': choose(output_mode::SYMBOLS); break;
         case 'h': print_usage(argv[0], optarg != nullptr); break;
         default: print_usage(argv[0]); break;
         }
     }
+    if (to_c && !chosen) mode = output_mode::DECOMPILE;
 
-    if (to_c) decompile();
-    else disassemble();
+    // the mode flags take no argument, so every input is an operand
+    std::vector<std::string> operands(argv + optind, argv + argc);
+    if (operands.size() == 0) {
+        std::cerr << "No input files\n";
+        print_usage(argv[0]);
+    }
 
-    return 0;
+    auto inputs = collect_inputs(operands);
+    int status;
+    if (inputs.size() == 1 && directory.size() == 0 &&
+        !std::filesystem::is_directory(operands[0]))
+        status = convert(inputs[0].path, mode, std::cout, jobs);
+    else status = convert_batch(inputs, mode, directory, jobs);
+    if (memoize) print_decode_report(std::cerr);
+    return status;
 }
@@ -0,0 +1,114 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "elf.h"
+
+
+/**
+ * One ARM function, f:
+ *   0x0  ldr r0, [pc], #4     post-indexed; reads and bumps pc, not a literal
+ *   0x4  ldr r1, [pc, #0]     literal at 0xc
+ *   0x8  bx  lr
+ *   0xc  .word 0x12345678     ($d)
+ */
+static std::string literal_object() {
+    const uint32_t code[] = { 0xe49f0004, 0xe59f1000, 0xe12fff1e, 0x12345678 };
+    const char section_names[] = "\0.shstrtab\0.strtab\0.symtab\0.text";
+    const char names[] = "\0$a\0$d\0f";
+
+    Elf32_Sym symbols[5];
+    memset(symbols, 0, sizeof(symbols));
+    symbols[1].st_info = STT_SECTION;
+    symbols[1].st_shndx = 4;
+    symbols[2].st_name = 1;
+    symbols[2].st_shndx = 4;
+    symbols[3].st_name = 4;
+    symbols[3].st_value = 0xc;
+    symbols[3].st_shndx = 4;
+    symbols[4].st_name = 7;
+    symbols[4].st_info = (STB_GLOBAL << 4) | STT_FUNC;
+    symbols[4].st_size = sizeof(code);
+    symbols[4].st_shndx = 4;
+
+    Elf32_Ehdr header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.e_ident, "\x7f" "ELF", 4);
+    header.e_ident[EI_CLASS] = ELFCLASS32;
+    header.e_ident[EI_DATA] = ELFDATA2LSB;
+    header.e_ident[EI_VERSION] = EV_CURRENT;
+    header.e_type = ET_REL;
+    header.e_machine = EM_ARM;
+    header.e_version = EV_CURRENT;
+    header.e_ehsize = sizeof(Elf32_Ehdr);
+    header.e_shentsize = sizeof(Elf32_Shdr);
+    header.e_shnum = 5;
+    header.e_shstrndx = 1;
+
+    std::string image((const char*)&header, sizeof(header));
+    Elf32_Shdr headers[5];
+    memset(headers, 0, sizeof(headers));
+    auto place = [&](size_t index, Elf32_Word name, Elf32_Word type, const void* data, size_t size) {
+        headers[index].sh_name = name;
+        headers[index].sh_type = type;
+        headers[index].sh_offset = image.size();
+        headers[index].sh_size = size;
+        image.append((const char*)data, size);
+    };
+    place(1, 1, SHT_STRTAB, section_names, sizeof(section_names));
+    place(2, 11, SHT_STRTAB, names, sizeof(names));
+    place(3, 19, SHT_SYMTAB, symbols, sizeof(symbols));
+    headers[3].sh_link = 2;
+    headers[3].sh_entsize = sizeof(Elf32_Sym);
+    place(4, 27, SHT_PROGBITS, code, sizeof(code));
+
+    uint32_t offset = image.size();
+    memcpy(&image[offsetof(Elf32_Ehdr, e_shoff)], &offset, 4);
+    image.append((const char*)headers, sizeof(headers));
+    return image;
+}
+
+static int failures = 0;
+
+static void expect(const std::string& output, const std::string& text, bool present) {
+    if ((output.find(text) != std::string::npos) == present) return;
+    std::cerr << (present ? "missing: " : "unexpected: ") << text << "\n";
+    failures++;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <elf2asm>\n";
+        return 1;
+    }
+
+    std::string object = "literal_loads.o";
+    std::string listing = "literal_loads.s";
+    std::ofstream(object, std::ios::binary) << literal_object();
+    std::string command = std::string("\"") + argv[1] + "\" " + object + " > " + listing;
+    if (std::system(command.c_str()) != 0) {
+        std::cerr << "failed: " << command << "\n";
+        return 1;
+    }
+
+    std::ostringstream os;
+    os << std::ifstream(listing).rdbuf();
+    std::string output = os.str();
+
+    expect(output, "LDR         R1, WORD_000c", true);
+    expect(output, "WORD_000c: .word 0x12345678", true);
+    expect(output, "BX          LR", true);
+    expect(output, "LDR         R0, [PC], #4", true);
+    expect(output, "WORD_0008", false);
+
+    std::remove(object.c_str());
+    std::remove(listing.c_str());
+    if (failures) std::cerr << output;
+    return failures ? 1 : 0;
+}
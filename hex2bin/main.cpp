@@ -2,6 +2,7 @@
 #include <iomanip>
 #include <fstream>
 #include <string>
+#include <vector>
 
 
 
@@ -10,42 +11,79 @@ void print_usage(const char* program)
 
 
 
-char char2nibble(char c) {
-    if (c >= '0' && c <= '9') return c - '0';
-    else if (c >= 'a' && c <= 'f') return c - 'a' + 10;
-    else if (c >= 'A' && c <= 'F') return c - 'A' + 10;
-    else {
-        std::cout << "Unrecognized character " << (int)c << std::endl;
-        std::cout << "Aborting!\n";
-        exit(1);
-        return 0;
+/**
+ * Nibble value of every input character: 0-15 for hex digits, skip for
+ * the whitespace separating them and bad for anything else.
+ */
+static const signed char skip = -1;
+static const signed char bad  = -2;
+
+struct nibble_table {
+    signed char value[256];
+
+    constexpr nibble_table() : value() {
+        for (int c = 0; c < 256; c++) value[c] = bad;
+        for (int c = '0'; c <= '9'; c++) value[c] = c - '0';
+        for (int c = 'a'; c <= 'f'; c++) value[c] = c - 'a' + 10;
+        for (int c = 'A'; c <= 'F'; c++) value[c] = c - 'A' + 10;
+        value[(int)' ']  = skip;
+        value[(int)'\t'] = skip;
+        value[(int)'\r'] = skip;
+        value[(int)'\n'] = skip;
     }
-}
+};
+
+static constexpr nibble_table nibbles;
+static const size_t block_size = 1 << 20;
 
 
 
 int translate(std::istream& in, std::ostream& out) {
-    char c;
-    char byte = 0;
-    unsigned int count = 0;
-
-    std::cout << std::setfill('0') << std::hex;
-    in >> std::noskipws;
-    while (in >> c) {
-        if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
-            continue;
-        byte = (byte << 4) | (0xF & char2nibble(c));
-        //std::cout << c;
-        if ((count % 2) == 1) {
-            //std::cout << ':' << std::setw(2) << (unsigned int)(byte) << ' ';
-            out.write(&byte, 1);
-            byte = 0;
+    std::vector<unsigned char> input(block_size);
+    std::vector<char> output;
+    output.reserve(block_size / 2 + 1);
+
+    size_t offset = 0;  /* input offset of input[0] */
+    int high = -1;      /* pending high nibble, -1 if none */
+    while (in.read((char*)input.data(), input.size()) || in.gcount() > 0) {
+        size_t size = in.gcount();
+        const unsigned char* p = input.data();
+        const unsigned char* end = p + size;
+
+        while (p < end) {
+            // fast path: a whole byte as two adjacent digits
+            if (high < 0 && end - p >= 2) {
+                int h = nibbles.value[p[0]];
+                int l = nibbles.value[p[1]];
+                if ((h | l) >= 0) {
+                    output.push_back((char)((h << 4) | l));
+                    p += 2;
+                    continue;
+                }
+            }
+
+            int n = nibbles.value[*p];
+            if (n == bad) {
+                out.write(output.data(), output.size());
+                std::cerr << "Unrecognized character 0x" << std::hex;
+                std::cerr << (int)*p << std::dec << " at offset ";
+                std::cerr << (offset + (p - input.data())) << std::endl;
+                return 1;
+            }
+            p++;
+            if (n == skip) continue;
+            if (high < 0) high = n;
+            else {
+                output.push_back((char)((high << 4) | n));
+                high = -1;
+            }
         }
-        count++;
-	//if (count == 20) break;
+
+        out.write(output.data(), output.size());
+        output.clear();
+        offset += size;
     }
-    std::cout << std::setfill(' ') << std::dec;
-    std::cout << std::endl;
+
     return 0;
 }
 
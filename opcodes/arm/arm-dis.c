@@ -22,6 +22,8 @@
 
 #include "sysdep.h"
 #include <assert.h>
+#include <errno.h>
+#include <pthread.h>
 
 #include "disassemble.h"
 #include "opcode/arm.h"
@@ -51,21 +53,23 @@ enum map_type {
     MAP_DATA
 };
 
-struct arm_private_data {
-    /* The features to use when disassembling optional instructions.  */
-    arm_feature_set features;
-
-    /* Track the last type (although this doesn't seem to be useful) */
-    enum map_type last_type;
-
-    /* Tracking symbol table information */
-    int last_mapping_sym;
-
-    /* The end range of the current range being disassembled.  */
-    bfd_vma last_stop_offset;
-    bfd_vma last_mapping_addr;
+/* Opcode tables an insn_opcode id can refer to.  The id packs the table in
+   the upper half and the entry index in the lower half.  */
+enum arm_opcode_table {
+    ARM_TABLE_NONE,
+    ARM_TABLE_ARM,
+    ARM_TABLE_THUMB16,
+    ARM_TABLE_THUMB32,
+    ARM_TABLE_COPROC,
+    ARM_TABLE_GENERIC_COPROC,
+    ARM_TABLE_NEON,
+    ARM_TABLE_MVE,
+    ARM_TABLE_CDE
 };
 
+#define ARM_OPCODE_ID(table, entry) \
+    ((unsigned int)(((table) << 16) | (entry)))
+
 enum mve_instructions {
     MVE_VPST,
     MVE_VPT_FP_T1,
@@ -5234,37 +5238,281 @@ struct vpt_block {
     long num_pred_insn;
 };
 
-static struct vpt_block vpt_block_state = {
-    FALSE,
-    PRED_NONE,
-    0,
-    0,
-    0
+/* Per disassemble_info decoder state, kept in INFO->private_data so that
+   independent disassemble_info objects can be used from different threads.  */
+struct arm_private_data {
+    /* The features to use when disassembling optional instructions.  */
+    arm_feature_set features;
+
+    /* Track the last type (although this doesn't seem to be useful) */
+    enum map_type last_type;
+
+    /* Tracking symbol table information */
+    int last_mapping_sym;
+
+    /* The end range of the current range being disassembled.  */
+    bfd_vma last_stop_offset;
+    bfd_vma last_mapping_addr;
+
+    /* Mapping symbols looked up through the caller when there is no
+       symbol table, and the run the last lookup returned.  */
+    arm_mapping_ftype mapping_func;
+    bfd_vma mapping_start;
+    bfd_vma mapping_end;
+    int mapping_type;
+
+    /* Register name set, index into regnames.  */
+    unsigned int regname_selected;
+
+    bfd_boolean force_thumb;
+    uint16_t cde_coprocs;
+
+    /* Current IT instruction state.  This contains the same state as the IT
+       bits in the CPSR.  */
+    unsigned int ifthen_state;
+    /* IT state for the next instruction.  */
+    unsigned int ifthen_next_state;
+    /* The address of the insn for which the IT state is valid.  */
+    bfd_vma ifthen_address;
+
+    struct vpt_block vpt_block_state;
 };
 
+#define ARM_PRIVATE(info) ((struct arm_private_data *) (info)->private_data)
+
 /* Default to GCC register name set.  */
-static unsigned int regname_selected = 1;
+#define ARM_DEFAULT_REGNAMES 1
 
 #define ARRAY_SIZE(a) (sizeof (a) / sizeof ((a)[0]))
 #define NUM_ARM_OPTIONS   ARRAY_SIZE (regnames)
-#define arm_regnames      regnames[regname_selected].reg_names
-
-static bfd_boolean force_thumb = FALSE;
-static uint16_t cde_coprocs = 0;
-
-/* Current IT instruction state.  This contains the same state as the IT
-   bits in the CPSR.  */
-static unsigned int ifthen_state;
-/* IT state for the next instruction.  */
-static unsigned int ifthen_next_state;
-/* The address of the insn for which the IT state is valid.  */
-static bfd_vma ifthen_address;
-#define IFTHEN_COND ((ifthen_state >> 4) & 0xf)
+#define arm_regnames      regnames[ARM_PRIVATE (info)->regname_selected].reg_names
+
+#define IFTHEN_COND ((ARM_PRIVATE (info)->ifthen_state >> 4) & 0xf)
 /* Indicates that the current Conditional state is unconditional or outside
    an IT block.  */
 #define COND_UNCOND 16
 
 
+/* Opcode dispatch.  A table is split into buckets keyed by a few
+   discriminating bits of the instruction word.  Every entry whose
+   mask/value pair could match a word with a given key is listed in that
+   key's bucket, in table order, so scanning a bucket finds the same first
+   match as scanning the whole table.  Sentinel entries are listed in every
+   bucket.  The indices are built once, on first use.  */
+
+struct arm_dispatch {
+    /* The key is bits [hi_shift, hi_shift + hi_bits) of the word followed
+       by bits [lo_shift, lo_shift + lo_bits).  */
+    unsigned int hi_shift, hi_bits;
+    unsigned int lo_shift, lo_bits;
+    /* Bucket K is entries[start[K]] up to entries[start[K + 1]].  */
+    unsigned int *start;
+    unsigned short *entries;
+    /* Entries in the table, not counting the terminating one.  */
+    unsigned int size;
+};
+
+static struct arm_dispatch arm_dispatch_arm = { 20, 8, 4, 4, NULL, NULL, 0 };
+static struct arm_dispatch arm_dispatch_coproc = { 20, 8, 4, 4, NULL, NULL, 0 };
+static struct arm_dispatch arm_dispatch_generic_coproc = { 20, 8, 4, 4, NULL, NULL, 0 };
+static struct arm_dispatch arm_dispatch_neon = { 19, 9, 4, 4, NULL, NULL, 0 };
+static struct arm_dispatch arm_dispatch_thumb32 = { 20, 9, 12, 4, NULL, NULL, 0 };
+static struct arm_dispatch arm_dispatch_mve = { 16, 13, 4, 1, NULL, NULL, 0 };
+
+static pthread_once_t arm_dispatch_once = PTHREAD_ONCE_INIT;
+
+/* The lookups arm_set_dispatch has left on, and 0, 1, 2 ... for scanning
+   a whole table in order when the bucketed ones are off.  */
+static int arm_dispatch_enabled = ARM_DISPATCH_ALL;
+static unsigned short *arm_dispatch_all;
+
+static unsigned long
+arm_dispatch_key(
+    const struct arm_dispatch *dispatch,
+    unsigned long given)
+{
+    unsigned long hi = (given >> dispatch->hi_shift)
+        & ((1ul << dispatch->hi_bits) - 1);
+    unsigned long lo = (given >> dispatch->lo_shift)
+        & ((1ul << dispatch->lo_bits) - 1);
+    return (hi << dispatch->lo_bits) | lo;
+}
+
+
+/* Fill DISPATCH for a table of N entries.  ALWAYS marks the entries that
+   must be kept in every bucket.  */
+
+static void
+arm_dispatch_build(
+    struct arm_dispatch *dispatch,
+    unsigned int n,
+    const unsigned long *mask,
+    const unsigned long *value,
+    const unsigned char *always)
+{
+    unsigned long keys = 1ul << (dispatch->hi_bits + dispatch->lo_bits);
+    unsigned long *key_of_mask = malloc (n * sizeof (unsigned long));
+    unsigned long *key_of_value = malloc (n * sizeof (unsigned long));
+    unsigned long total = 0;
+    unsigned long key;
+    unsigned int i;
+
+    assert (arm_dispatch_key (dispatch, 0xffffffff) == keys - 1);
+    if (key_of_mask == NULL || key_of_value == NULL)
+        abort ();
+    for (i = 0; i < n; i++) {
+        key_of_mask[i] = arm_dispatch_key (dispatch, mask[i]);
+        key_of_value[i] = arm_dispatch_key (dispatch, value[i]);
+    }
+
+    dispatch->start = malloc ((keys + 1) * sizeof (unsigned int));
+    if (dispatch->start == NULL)
+        abort ();
+    for (key = 0; key < keys; key++) {
+        dispatch->start[key] = total;
+        for (i = 0; i < n; i++)
+            if (always[i] || (key & key_of_mask[i]) == key_of_value[i])
+                total++;
+    }
+    dispatch->start[keys] = total;
+
+    dispatch->entries = malloc (total * sizeof (unsigned short) + 1);
+    if (dispatch->entries == NULL)
+        abort ();
+    total = 0;
+    for (key = 0; key < keys; key++)
+        for (i = 0; i < n; i++)
+            if (always[i] || (key & key_of_mask[i]) == key_of_value[i])
+                dispatch->entries[total++] = i;
+
+    dispatch->size = n;
+    free (key_of_mask);
+    free (key_of_value);
+}
+
+
+/* Collect the mask/value pairs of TABLE, up to its terminating entry, and
+   build DISPATCH from them.  */
+
+#define ARM_DISPATCH_BUILD(dispatch, table)				\
+    do {								\
+        unsigned long mask[ARRAY_SIZE (table)];				\
+        unsigned long value[ARRAY_SIZE (table)];			\
+        unsigned char always[ARRAY_SIZE (table)];			\
+        unsigned int n;							\
+        for (n = 0; table[n].assembler; n++) {				\
+            mask[n] = table[n].mask;					\
+            value[n] = table[n].value;					\
+            always[n] = ARM_FEATURE_ZERO (table[n].arch)		\
+                || table[n].value == SENTINEL_IWMMXT_END;		\
+        }								\
+        arm_dispatch_build (&(dispatch), n, mask, value, always);	\
+    } while (0)
+
+/* The 16-bit Thumb table is small enough to index directly: for every
+   halfword, the first thumb_opcodes entry that matches it, or the index of
+   the terminating entry if none does.  */
+
+static unsigned short *thumb16_dispatch;
+
+static void
+thumb16_dispatch_build(void)
+{
+    unsigned int n, i;
+
+    for (n = 0; thumb_opcodes[n].assembler; n++)
+        continue;
+
+    thumb16_dispatch = malloc (0x10000 * sizeof (unsigned short));
+    if (thumb16_dispatch == NULL)
+        abort ();
+    for (i = 0; i < 0x10000; i++)
+        thumb16_dispatch[i] = n;
+
+    /* Entries are filled in last to first, so that an earlier entry
+       overwrites a later one on the halfwords both match.  Only the bits
+       outside an entry's mask are enumerated.  */
+    for (i = n; i-- > 0; ) {
+        unsigned long mask = thumb_opcodes[i].mask & 0xffff;
+        unsigned long value = thumb_opcodes[i].value;
+        unsigned long free_bits = ~mask & 0xffff;
+        unsigned long bits = free_bits;
+
+        if ((value & ~mask) != 0)
+            continue; /* can never match */
+        for (;;) {
+            thumb16_dispatch[value | bits] = i;
+            if (bits == 0)
+                break;
+            bits = (bits - 1) & free_bits;
+        }
+    }
+}
+
+static void
+arm_dispatch_init(void)
+{
+    const struct arm_dispatch *tables[] = {
+        &arm_dispatch_arm, &arm_dispatch_coproc, &arm_dispatch_generic_coproc,
+        &arm_dispatch_neon, &arm_dispatch_thumb32, &arm_dispatch_mve
+    };
+    unsigned int largest = 0;
+    unsigned int i;
+
+    thumb16_dispatch_build ();
+    ARM_DISPATCH_BUILD (arm_dispatch_arm, arm_opcodes);
+    ARM_DISPATCH_BUILD (arm_dispatch_coproc, coprocessor_opcodes);
+    ARM_DISPATCH_BUILD (arm_dispatch_generic_coproc, generic_coprocessor_opcodes);
+    ARM_DISPATCH_BUILD (arm_dispatch_neon, neon_opcodes);
+    ARM_DISPATCH_BUILD (arm_dispatch_thumb32, thumb32_opcodes);
+    ARM_DISPATCH_BUILD (arm_dispatch_mve, mve_opcodes);
+
+    for (i = 0; i < ARRAY_SIZE (tables); i++)
+        if (tables[i]->size > largest)
+            largest = tables[i]->size;
+    arm_dispatch_all = malloc (largest * sizeof (unsigned short) + 1);
+    if (arm_dispatch_all == NULL)
+        abort ();
+    for (i = 0; i < largest; i++)
+        arm_dispatch_all[i] = i;
+}
+
+
+/* Return the candidate entries of DISPATCH for GIVEN and set *COUNT to
+   their number.  */
+
+static const unsigned short *
+arm_dispatch_lookup(
+    const struct arm_dispatch *dispatch,
+    unsigned long given,
+    unsigned int *count)
+{
+    unsigned long key;
+
+    pthread_once (&arm_dispatch_once, arm_dispatch_init);
+    if (!(arm_dispatch_enabled & ARM_DISPATCH_TABLES)) {
+        *count = dispatch->size;
+        return arm_dispatch_all;
+    }
+    key = arm_dispatch_key (dispatch, given);
+    *count = dispatch->start[key + 1] - dispatch->start[key];
+    return dispatch->entries + dispatch->start[key];
+}
+
+
+/* Return the index of the first thumb_opcodes entry that matches the
+   16-bit instruction GIVEN, or 0 to have the caller scan from the top.  */
+
+static unsigned int
+thumb16_dispatch_lookup(unsigned long given)
+{
+    if (!(arm_dispatch_enabled & ARM_DISPATCH_THUMB16))
+        return 0;
+    pthread_once (&arm_dispatch_once, arm_dispatch_init);
+    return thumb16_dispatch[given & 0xffff];
+}
+
+
 /* Functions.  */
 /* Extract the predicate mask for a VPT or VPST instruction.
    The mask is composed of bits 13-15 (Mkl) and bit 22 (Mkh).  */
@@ -5289,25 +5537,25 @@ num_instructions_vpt_block(long given)
 
 
 static void
-mark_outside_vpt_block(void)
+mark_outside_vpt_block(struct vpt_block *vpt)
 {
-    vpt_block_state.in_vpt_block = FALSE;
-    vpt_block_state.next_pred_state = PRED_NONE;
-    vpt_block_state.predicate_mask = 0;
-    vpt_block_state.current_insn_num = 0;
-    vpt_block_state.num_pred_insn = 0;
+    vpt->in_vpt_block = FALSE;
+    vpt->next_pred_state = PRED_NONE;
+    vpt->predicate_mask = 0;
+    vpt->current_insn_num = 0;
+    vpt->num_pred_insn = 0;
 }
 
 
 static void
-mark_inside_vpt_block(long given)
+mark_inside_vpt_block(struct vpt_block *vpt, long given)
 {
-    vpt_block_state.in_vpt_block = TRUE;
-    vpt_block_state.next_pred_state = PRED_THEN;
-    vpt_block_state.predicate_mask = mve_extract_pred_mask (given);
-    vpt_block_state.current_insn_num = 0;
-    vpt_block_state.num_pred_insn = num_instructions_vpt_block (given);
-    assert (vpt_block_state.num_pred_insn >= 1);
+    vpt->in_vpt_block = TRUE;
+    vpt->next_pred_state = PRED_THEN;
+    vpt->predicate_mask = mve_extract_pred_mask (given);
+    vpt->current_insn_num = 0;
+    vpt->num_pred_insn = num_instructions_vpt_block (given);
+    assert (vpt->num_pred_insn >= 1);
 }
 
 
@@ -5321,12 +5569,12 @@ invert_next_predicate_state(enum vpt_pred_state astate)
 
 
 static enum vpt_pred_state
-update_next_predicate_state(void)
+update_next_predicate_state(const struct vpt_block *vpt)
 {
-    long pred_mask = vpt_block_state.predicate_mask;
+    long pred_mask = vpt->predicate_mask;
     long mask_for_insn = 0;
 
-    switch (vpt_block_state.current_insn_num) {
+    switch (vpt->current_insn_num) {
         case 1: mask_for_insn = 8; break;
         case 2: mask_for_insn = 4; break;
         case 3: mask_for_insn = 2; break;
@@ -5334,21 +5582,21 @@ update_next_predicate_state(void)
     }
 
     if (pred_mask & mask_for_insn)
-         return invert_next_predicate_state (vpt_block_state.next_pred_state);
-    else return vpt_block_state.next_pred_state;
+         return invert_next_predicate_state (vpt->next_pred_state);
+    else return vpt->next_pred_state;
 }
 
 
 static void
-update_vpt_block_state(void)
+update_vpt_block_state(struct vpt_block *vpt)
 {
-    vpt_block_state.current_insn_num++;
-    if (vpt_block_state.current_insn_num == vpt_block_state.num_pred_insn) {
+    vpt->current_insn_num++;
+    if (vpt->current_insn_num == vpt->num_pred_insn) {
         /* No more instructions to process in vpt block.  */
-        mark_outside_vpt_block ();
+        mark_outside_vpt_block (vpt);
         return;
     }
-    vpt_block_state.next_pred_state = update_next_predicate_state ();
+    vpt->next_pred_state = update_next_predicate_state (vpt);
 }
 
 
@@ -5393,10 +5641,12 @@ arm_decode_bitfield(
 static void
 arm_decode_shift(
     long given,
-    fprintf_ftype func,
-    void *stream,
+    struct disassemble_info *info,
 	bfd_boolean print_shift)
 {
+    fprintf_ftype func = info->fprintf_func;
+    void *stream = info->stream;
+
     func (stream, "%s", arm_regnames[given & 0xf]);
 
     if ((given & 0xff0) != 0) {
@@ -7158,9 +7408,10 @@ print_instruction_predicate(struct disassemble_info *info)
 {
     void *stream = info->stream;
     fprintf_ftype func = info->fprintf_func;
-    if (vpt_block_state.next_pred_state == PRED_THEN)
+    struct arm_private_data *private_data = info->private_data;
+    if (private_data->vpt_block_state.next_pred_state == PRED_THEN)
         func (stream, "t");
-    else if (vpt_block_state.next_pred_state == PRED_ELSE)
+    else if (private_data->vpt_block_state.next_pred_state == PRED_ELSE)
         func (stream, "e");
 }
 
@@ -7545,12 +7796,15 @@ print_vec_condition(
 static bfd_boolean
 print_insn_coprocessor_1(
     const struct sopcode32 *opcodes,
+    const struct arm_dispatch *dispatch,
 	bfd_vma pc,
 	struct disassemble_info *info,
 	long given,
 	bfd_boolean thumb)
 {
     const struct sopcode32 *insn;
+    const unsigned short *candidates;
+    unsigned int count, k;
     void *stream = info->stream;
     fprintf_ftype func = info->fprintf_func;
     unsigned long mask;
@@ -7564,19 +7818,21 @@ print_insn_coprocessor_1(
 
     allowed_arches = private_data->features;
 
-    for (insn = opcodes; insn->assembler; insn++) {
+    candidates = arm_dispatch_lookup (dispatch, given, &count);
+    for (k = 0; k < count; k++) {
         unsigned long u_reg = 16;
         bfd_boolean is_unpredictable = FALSE;
         signed long value_in_comment = 0;
         const char *c;
 
+        insn = opcodes + candidates[k];
         if (ARM_FEATURE_ZERO (insn->arch))
 	        switch (insn->value) {
 	        case SENTINEL_IWMMXT_START:
 	            if (info->mach != bfd_mach_arm_XScale
 		            && info->mach != bfd_mach_arm_iWMMXt
 		            && info->mach != bfd_mach_arm_iWMMXt2)
-	                do insn++;
+	                do insn = opcodes + candidates[++k];
 	                while ((! ARM_FEATURE_ZERO (insn->arch))
 		                && insn->value != SENTINEL_IWMMXT_END);
 	            continue;
@@ -7602,7 +7858,7 @@ print_insn_coprocessor_1(
             encoding is the same.  */
             mask |= 0xf0000000;
             value |= 0xe0000000;
-            if (ifthen_state)
+            if (private_data->ifthen_state)
                     cond = IFTHEN_COND;
             else cond = COND_UNCOND;
         }
@@ -7670,6 +7926,11 @@ print_insn_coprocessor_1(
             don't let it match here.  */
             continue;
 
+        info->insn_opcode = ARM_OPCODE_ID (opcodes == coprocessor_opcodes
+            ? ARM_TABLE_COPROC : ARM_TABLE_GENERIC_COPROC, insn - opcodes);
+        if (cond != COND_UNCOND)
+            info->insn_cond = cond;
+
         for (c = insn->assembler; *c; c++) {
             if (*c == '%') {
                 const char mod = *++c;
@@ -8099,7 +8360,7 @@ print_insn_coprocessor(
 	bfd_boolean thumb)
 {
     return print_insn_coprocessor_1(coprocessor_opcodes,
-		pc, info, given, thumb);
+		&arm_dispatch_coproc, pc, info, given, thumb);
 }
 
 
@@ -8111,7 +8372,7 @@ print_insn_generic_coprocessor(
 	bfd_boolean thumb)
 {
     return print_insn_coprocessor_1(generic_coprocessor_opcodes,
-		pc, info, given, thumb);
+		&arm_dispatch_generic_coproc, pc, info, given, thumb);
 }
 
 
@@ -8177,7 +8438,7 @@ print_arm_address(
             }
             else {
                 func (stream, ", %s", NEGATIVE_BIT_SET ? "-" : "");
-                arm_decode_shift (given, func, stream, TRUE);
+                arm_decode_shift (given, info, TRUE);
             }
 
             func (stream, "]%s",
@@ -8193,7 +8454,7 @@ print_arm_address(
 	        else {
 	            func (stream, "], %s",
 		            NEGATIVE_BIT_SET ? "-" : "");
-	            arm_decode_shift (given, func, stream, TRUE);
+	            arm_decode_shift (given, info, TRUE);
 	        }
 	    }
         if (NEGATIVE_BIT_SET)
@@ -8215,6 +8476,7 @@ print_insn_cde(
     const struct cdeopcode32 *insn;
     void *stream = info->stream;
     fprintf_ftype func = info->fprintf_func;
+    struct arm_private_data *private_data = info->private_data;
 
     if (thumb) {
         /* Manually extract the coprocessor code from a known point.
@@ -8222,13 +8484,14 @@ print_insn_cde(
         for (insn = cde_opcodes; insn->assembler; insn++) {
             uint16_t coproc = (given >> insn->coproc_shift) & insn->coproc_mask;
             uint16_t coproc_mask = 1 << coproc;
-            if (! (coproc_mask & cde_coprocs))
+            if (! (coproc_mask & private_data->cde_coprocs))
 	            continue;
 
             if ((given & insn->mask) == insn->value) {
 	            bfd_boolean is_unpredictable = FALSE;
 	            const char *c;
 
+	            info->insn_opcode = ARM_OPCODE_ID (ARM_TABLE_CDE, insn - cde_opcodes);
 	            for (c = insn->assembler; *c; c++) {
 	                if (*c == '%') {
 	                    switch (*++c) {
@@ -8323,8 +8586,11 @@ print_insn_neon(
     bfd_boolean thumb)
 {
     const struct opcode32 *insn;
+    const unsigned short *candidates;
+    unsigned int count, k;
     void *stream = info->stream;
     fprintf_ftype func = info->fprintf_func;
+    struct arm_private_data *private_data = info->private_data;
 
     if (thumb) {
         if ((given & 0xef000000) == 0xef000000) {
@@ -8346,22 +8612,25 @@ print_insn_neon(
 	        return FALSE;
     }
 
-    for (insn = neon_opcodes; insn->assembler; insn++) {
+    candidates = arm_dispatch_lookup (&arm_dispatch_neon, given, &count);
+    for (k = 0; k < count; k++) {
+        insn = neon_opcodes + candidates[k];
         if ((given & insn->mask) == insn->value) {
 	        signed long value_in_comment = 0;
 	        bfd_boolean is_unpredictable = FALSE;
 	        const char *c;
 
+	        info->insn_opcode = ARM_OPCODE_ID (ARM_TABLE_NEON, insn - neon_opcodes);
 	        for (c = insn->assembler; *c; c++) {
 	            if (*c == '%') {
 		            switch (*++c) {
 		            case '%': func (stream, "%%"); break;
 		            case 'u':
-		                if (thumb && ifthen_state)
+		                if (thumb && private_data->ifthen_state)
 			                is_unpredictable = TRUE;
 		                /* Fall through.  */
 		            case 'c':
-		                if (thumb && ifthen_state)
+		                if (thumb && private_data->ifthen_state)
 			                func (stream, "%s", arm_conditional[IFTHEN_COND]);
 		                break;
 		            case 'A': {
@@ -8712,10 +8981,15 @@ print_insn_mve(
     long given)
 {
     const struct mopcode32 *insn;
+    const unsigned short *candidates;
+    unsigned int count, k;
     void *stream = info->stream;
     fprintf_ftype func = info->fprintf_func;
+    struct arm_private_data *private_data = info->private_data;
 
-    for (insn = mve_opcodes; insn->assembler; insn++) {
+    candidates = arm_dispatch_lookup (&arm_dispatch_mve, given, &count);
+    for (k = 0; k < count; k++) {
+        insn = mve_opcodes + candidates[k];
         if (((given & insn->mask) == insn->value)
 	        && !is_mve_encoding_conflict (given, insn->mve_op)) {
 	        signed long value_in_comment = 0;
@@ -8727,7 +9001,7 @@ print_insn_mve(
 
             /* Most vector mve instruction are illegal in a it block.
                 There are a few exceptions; check for them.  */
-            if (ifthen_state && !is_mve_okay_in_it (insn->mve_op)) {
+            if (private_data->ifthen_state && !is_mve_okay_in_it (insn->mve_op)) {
 	            is_unpredictable = TRUE;
 	            unpredictable_cond = UNPRED_IT_BLOCK;
 	        }
@@ -8745,6 +9019,7 @@ print_insn_mve(
 		        == arm_decode_field (given, 17, 19)))
 	            continue;
 
+	        info->insn_opcode = ARM_OPCODE_ID (ARM_TABLE_MVE, insn - mve_opcodes);
 	        for (c = insn->assembler; *c; c++) {
 	            if (*c == '%') {
                     switch (*++c) {
@@ -8755,7 +9030,7 @@ print_insn_mve(
                             func (stream, "-");
                         break;
                     case 'c':
-                        if (ifthen_state)
+                        if (private_data->ifthen_state)
                             func (stream, "%s", arm_conditional[IFTHEN_COND]);
                         break;
                     case 'd':
@@ -8975,12 +9250,12 @@ print_insn_mve(
             if (is_undefined)
                 print_mve_undefined (info, undefined_cond);
 
-            if ((vpt_block_state.in_vpt_block == FALSE)
-                && !ifthen_state
+            if ((private_data->vpt_block_state.in_vpt_block == FALSE)
+                && !private_data->ifthen_state
                 && (is_vpt_instruction (given) == TRUE))
-                mark_inside_vpt_block (given);
-            else if (vpt_block_state.in_vpt_block == TRUE)
-                update_vpt_block_state ();
+                mark_inside_vpt_block (&private_data->vpt_block_state, given);
+            else if (private_data->vpt_block_state.in_vpt_block == TRUE)
+                update_vpt_block_state (&private_data->vpt_block_state);
 
 	        return TRUE;
 	    }
@@ -9063,6 +9338,8 @@ static void
 print_insn_arm (bfd_vma pc, struct disassemble_info *info, long given)
 {
   const struct opcode32 *insn;
+  const unsigned short *candidates;
+  unsigned int count, k;
   void *stream = info->stream;
   fprintf_ftype func = info->fprintf_func;
   struct arm_private_data *private_data = info->private_data;
@@ -9076,8 +9353,10 @@ print_insn_arm (bfd_vma pc, struct disassemble_info *info, long given)
   if (print_insn_generic_coprocessor (pc, info, given, FALSE))
     return;
 
-  for (insn = arm_opcodes; insn->assembler; insn++)
+  candidates = arm_dispatch_lookup (&arm_dispatch_arm, given, &count);
+  for (k = 0; k < count; k++)
     {
+      insn = arm_opcodes + candidates[k];
       if ((given & insn->mask) != insn->value)
 	continue;
 
@@ -9097,6 +9376,10 @@ print_insn_arm (bfd_vma pc, struct disassemble_info *info, long given)
 	  signed long value_in_comment = 0;
 	  const char *c;
 
+	  info->insn_opcode = ARM_OPCODE_ID (ARM_TABLE_ARM, insn - arm_opcodes);
+	  if ((given & 0xF0000000) != 0xF0000000)
+	    info->insn_cond = (given >> 28) & 0xf;
+
 	  for (c = insn->assembler; *c; c++)
 	    {
 	      if (*c == '%')
@@ -9271,7 +9554,7 @@ print_insn_arm (bfd_vma pc, struct disassemble_info *info, long given)
 		      break;
 
 		    case 'q':
-		      arm_decode_shift (given, func, stream, FALSE);
+		      arm_decode_shift (given, info, FALSE);
 		      break;
 
 		    case 'o':
@@ -9296,7 +9579,7 @@ print_insn_arm (bfd_vma pc, struct disassemble_info *info, long given)
 			  value_in_comment = a;
 			}
 		      else
-			arm_decode_shift (given, func, stream, TRUE);
+			arm_decode_shift (given, info, TRUE);
 		      break;
 
 		    case 'p':
@@ -9510,7 +9793,12 @@ print_insn_arm (bfd_vma pc, struct disassemble_info *info, long given)
 			  case '\'':
 			    c++;
 			    if (value == ((1ul << width) - 1))
-			      func (stream, "%c", *c);
+			      {
+				func (stream, "%c", *c);
+				/* "%20's" is the S flag; "%6's" is the sign of ldrsh.  */
+				if (*c == 's' && strncmp (c - 4, "%20'", 4) == 0)
+				  info->insn_set_flags = 1;
+			      }
 			    break;
 			  case '?':
 			    func (stream, "%c", c[(1 << width) - (int) value]);
@@ -9606,13 +9894,18 @@ print_insn_thumb16 (bfd_vma pc, struct disassemble_info *info, long given)
   const struct opcode16 *insn;
   void *stream = info->stream;
   fprintf_ftype func = info->fprintf_func;
+  struct arm_private_data *private_data = info->private_data;
 
-  for (insn = thumb_opcodes; insn->assembler; insn++)
+  /* The scan starts at the entry that matches, so it ends there.  */
+  for (insn = thumb_opcodes + thumb16_dispatch_lookup (given);
+       insn->assembler; insn++)
     if ((given & insn->mask) == insn->value)
       {
 	signed long value_in_comment = 0;
 	const char *c = insn->assembler;
 
+	info->insn_opcode = ARM_OPCODE_ID (ARM_TABLE_THUMB16, insn - thumb_opcodes);
+
 	for (; *c; c++)
 	  {
 	    int domaskpc = 0;
@@ -9631,22 +9924,25 @@ print_insn_thumb16 (bfd_vma pc, struct disassemble_info *info, long given)
 		break;
 
 	      case 'c':
-		if (ifthen_state)
+		if (private_data->ifthen_state)
 		  func (stream, "%s", arm_conditional[IFTHEN_COND]);
 		break;
 
 	      case 'C':
-		if (ifthen_state)
+		if (private_data->ifthen_state)
 		  func (stream, "%s", arm_conditional[IFTHEN_COND]);
 		else
-		  func (stream, "s");
+		  {
+		    func (stream, "s");
+		    info->insn_set_flags = 1;
+		  }
 		break;
 
 	      case 'I':
 		{
 		  unsigned int tmp;
 
-		  ifthen_next_state = given & 0xff;
+		  private_data->ifthen_next_state = given & 0xff;
 		  for (tmp = given << 1; tmp & 0xf; tmp <<= 1)
 		    func (stream, ((given ^ tmp) & 0x10) ? "e" : "t");
 		  func (stream, "\t%s", arm_conditional[(given >> 4) & 0xf]);
@@ -9654,12 +9950,12 @@ print_insn_thumb16 (bfd_vma pc, struct disassemble_info *info, long given)
 		break;
 
 	      case 'x':
-		if (ifthen_next_state)
+		if (private_data->ifthen_next_state)
 		  func (stream, "\t; unpredictable branch in IT block\n");
 		break;
 
 	      case 'X':
-		if (ifthen_state)
+		if (private_data->ifthen_state)
 		  func (stream, "\t; unpredictable <IT:%s>",
 			arm_conditional[IFTHEN_COND]);
 		break;
@@ -9838,6 +10134,7 @@ print_insn_thumb16 (bfd_vma pc, struct disassemble_info *info, long given)
 
 			  case 'c':
 			    func (stream, "%s", arm_conditional [reg]);
+			    info->insn_cond = reg;
 			    break;
 
 			  default:
@@ -9924,8 +10221,11 @@ static void
 print_insn_thumb32(bfd_vma pc, struct disassemble_info *info, long given)
 {
   const struct opcode32 *insn;
+  const unsigned short *candidates;
+  unsigned int count, k;
   void *stream = info->stream;
   fprintf_ftype func = info->fprintf_func;
+  struct arm_private_data *private_data = info->private_data;
   bfd_boolean is_mve = is_mve_architecture (info);
 
   if (print_insn_coprocessor (pc, info, given, TRUE))
@@ -9943,14 +10243,18 @@ print_insn_thumb32(bfd_vma pc, struct disassemble_info *info, long given)
   if (print_insn_generic_coprocessor (pc, info, given, TRUE))
     return;
 
-  for (insn = thumb32_opcodes; insn->assembler; insn++)
-    if ((given & insn->mask) == insn->value)
+  candidates = arm_dispatch_lookup (&arm_dispatch_thumb32, given, &count);
+  for (k = 0; k < count; k++)
+    if (insn = thumb32_opcodes + candidates[k],
+	(given & insn->mask) == insn->value)
       {
 	bfd_boolean is_clrm = FALSE;
 	bfd_boolean is_unpredictable = FALSE;
 	signed long value_in_comment = 0;
 	const char *c = insn->assembler;
 
+	info->insn_opcode = ARM_OPCODE_ID (ARM_TABLE_THUMB32, insn - thumb32_opcodes);
+
 	for (; *c; c++)
 	  {
 	    if (*c != '%')
@@ -9966,17 +10270,17 @@ print_insn_thumb32(bfd_vma pc, struct disassemble_info *info, long given)
 		break;
 
 	      case 'c':
-		if (ifthen_state)
+		if (private_data->ifthen_state)
 		  func (stream, "%s", arm_conditional[IFTHEN_COND]);
 		break;
 
 	      case 'x':
-		if (ifthen_next_state)
+		if (private_data->ifthen_next_state)
 		  func (stream, "\t; unpredictable branch in IT block\n");
 		break;
 
 	      case 'X':
-		if (ifthen_state)
+		if (private_data->ifthen_state)
 		  func (stream, "\t; unpredictable <IT:%s>",
 			arm_conditional[IFTHEN_COND]);
 		break;
@@ -10575,12 +10879,19 @@ print_insn_thumb32(bfd_vma pc, struct disassemble_info *info, long given)
 
 		    case 'c':
 		      func (stream, "%s", arm_conditional[val]);
+		      /* Only a condition in the mnemonic is the insn's own.  */
+		      if (c < strchr (insn->assembler, '\t'))
+			info->insn_cond = val;
 		      break;
 
 		    case '\'':
 		      c++;
 		      if (val == ((1ul << width) - 1))
-			func (stream, "%c", *c);
+			{
+			  func (stream, "%c", *c);
+			  if (*c == 's' && strncmp (c - 4, "%20'", 4) == 0)
+			    info->insn_set_flags = 1;
+			}
 		      break;
 
 		    case '`':
@@ -10683,7 +10994,9 @@ arm_symbol_is_valid(
 /* Parse the string of disassembler options.  */
 
 static void
-parse_arm_disassembler_options(const char *options)
+parse_arm_disassembler_options(
+    struct arm_private_data *private_data,
+    const char *options)
 {
     const char *opt;
 
@@ -10692,7 +11005,7 @@ parse_arm_disassembler_options(const char *options)
 	        unsigned int i;
 	        for (i = 0; i < NUM_ARM_OPTIONS; i++)
 	            if (disassembler_options_cmp (opt, regnames[i].name) == 0) {
-		            regname_selected = i;
+		            private_data->regname_selected = i;
 		            break;
 	            }
 
@@ -10701,9 +11014,9 @@ parse_arm_disassembler_options(const char *options)
 	            opcodes_error_handler (_("unrecognised register name set: %s"), opt);
 	    }
         else if (CONST_STRNEQ (opt, "force-thumb"))
-	        force_thumb = 1;
+	        private_data->force_thumb = 1;
         else if (CONST_STRNEQ (opt, "no-force-thumb"))
-	        force_thumb = 0;
+	        private_data->force_thumb = 0;
         else if (CONST_STRNEQ (opt, "coproc")) {
 	        const char *procptr = opt + sizeof ("coproc") - 1;
 	        char *endptr;
@@ -10718,10 +11031,10 @@ parse_arm_disassembler_options(const char *options)
 	        }
 	        endptr += 1;
 	        if (CONST_STRNEQ (endptr, "generic"))
-	            cde_coprocs &= ~(1 << coproc_number);
+	            private_data->cde_coprocs &= ~(1 << coproc_number);
 	        else if (CONST_STRNEQ (endptr, "cde")
 		        || CONST_STRNEQ (endptr, "CDE"))
-	            cde_coprocs |= (1 << coproc_number);
+	            private_data->cde_coprocs |= (1 << coproc_number);
 	        else {
 	            opcodes_error_handler (
 		            _("coprocN argument takes options \"generic\","
@@ -10743,6 +11056,32 @@ mapping_symbol_for_insn(
 	enum map_type *map_symbol);
 
 
+/* Reads LENGTH bytes at MEMADDR for the decoder.  When INFO reads from one
+   contiguous buffer through buffer_read_memory, the bytes are taken from it
+   directly against a single bound, without the indirect call; any other
+   reader (sparse or overlay memory) is still called as before.  */
+
+static inline int
+arm_read_memory(
+    bfd_vma memaddr,
+    bfd_byte *myaddr,
+    unsigned int length,
+    struct disassemble_info *info)
+{
+    if (info->read_memory_func == buffer_read_memory
+        && info->octets_per_byte == 1 && info->stop_vma == 0) {
+        bfd_vma offset = memaddr - info->buffer_vma;
+
+        if (memaddr < info->buffer_vma || offset > info->buffer_length
+            || length > info->buffer_length - offset)
+            return EIO;
+        memcpy (myaddr, info->buffer + offset, length);
+        return 0;
+    }
+    return info->read_memory_func (memaddr, myaddr, length, info);
+}
+
+
 /* Search back through the insn stream to determine if this instruction is
    conditionally executed.  */
 
@@ -10761,9 +11100,10 @@ find_ifthen_state(
     int it_count;
     unsigned int seen_it;
     bfd_vma addr;
+    struct arm_private_data *private_data = info->private_data;
 
-    ifthen_address = pc;
-    ifthen_state = 0;
+    private_data->ifthen_address = pc;
+    private_data->ifthen_state = 0;
 
     addr = pc;
     count = 1;
@@ -10782,7 +11122,7 @@ find_ifthen_state(
 	        return;
 	    }
         addr -= 2;
-        status = info->read_memory_func (addr, (bfd_byte *) b, 2, info);
+        status = arm_read_memory (addr, (bfd_byte *) b, 2, info);
         if (status)
 	        return;
 
@@ -10817,9 +11157,9 @@ find_ifthen_state(
 	        return;
     }
     /* We found an IT instruction.  */
-    ifthen_state = (seen_it & 0xe0) | ((seen_it << it_count) & 0x1f);
-    if ((ifthen_state & 0xf) == 0)
-        ifthen_state = 0;
+    private_data->ifthen_state = (seen_it & 0xe0) | ((seen_it << it_count) & 0x1f);
+    if ((private_data->ifthen_state & 0xf) == 0)
+        private_data->ifthen_state = 0;
 }
 
 
@@ -10895,6 +11235,32 @@ get_sym_code_type(
 }
 
 
+/* mapping_symbol_for_insn for a caller-supplied index: the caller is only
+   asked again once PC leaves the run found last, so decoding in order costs
+   one (binary) search per run rather than one per instruction.  */
+
+static bfd_boolean
+mapping_run_for_insn(
+    bfd_vma pc,
+    struct disassemble_info *info,
+    enum map_type *map_symbol)
+{
+    struct arm_private_data *private_data = info->private_data;
+
+    if (pc < private_data->mapping_start || pc >= private_data->mapping_end)
+        private_data->mapping_type = private_data->mapping_func (pc,
+            &private_data->mapping_start, &private_data->mapping_end, info);
+
+    switch (private_data->mapping_type) {
+    case 'a': *map_symbol = MAP_ARM; break;
+    case 't': *map_symbol = MAP_THUMB; break;
+    case 'd': *map_symbol = MAP_DATA; break;
+    default:  return FALSE;
+    }
+    return TRUE;
+}
+
+
 /* Search the mapping symbol state for instruction at pc.  This is only
    applicable for elf target.
 
@@ -10929,6 +11295,14 @@ mapping_symbol_for_insn(
         type = MAP_ARM;
     struct arm_private_data *private_data;
 
+    if (info->private_data != NULL && info->symtab_size == 0
+        && ARM_PRIVATE (info)->mapping_func != NULL) {
+        found = mapping_run_for_insn (pc, info, &type);
+        ARM_PRIVATE (info)->last_type = type;
+        *map_symbol = type;
+        return found;
+    }
+
     if (info->private_data == NULL
         || bfd_asymbol_flavour (*info->symtab) != bfd_target_elf_flavour)
         return FALSE;
@@ -11027,7 +11401,7 @@ mapping_symbol_for_insn(
 static void
 select_arm_features(
     unsigned long mach,
-	arm_feature_set * features)
+	struct arm_private_data *private_data)
 {
     arm_feature_set arch_fset;
     const arm_feature_set fpu_any = FPU_ANY;
@@ -11080,7 +11454,7 @@ select_arm_features(
         arm_feature_set mve_all
 	        = ARM_FEATURE_CORE_HIGH (ARM_EXT2_MVE | ARM_EXT2_MVE_FP);
         ARM_MERGE_FEATURE_SETS (arch_fset, arch_fset, mve_all);
-        force_thumb = 1;
+        private_data->force_thumb = 1;
         break;
         /* If the machine type is unknown allow all architecture types and all
 	        extensions, with the exception of MVE as that clashes with NEON.  */
@@ -11095,48 +11469,21 @@ select_arm_features(
     /* None of the feature bits related to -mfpu have an impact on Tag_CPU_arch
         and thus on bfd_mach_arm_XXX value.  Therefore for a given
         bfd_mach_arm_XXX value all coprocessor feature bits should be allowed.  */
-    ARM_MERGE_FEATURE_SETS (*features, arch_fset, fpu_any);
+    ARM_MERGE_FEATURE_SETS (private_data->features, arch_fset, fpu_any);
 }
 
 
-/* NOTE: There are no checks in these routines that
-   the relevant number of data bytes exist.  */
+/* The decoder state of INFO, set up on first use.  */
 
-static int
-print_insn (
-    bfd_vma pc,
-    struct disassemble_info* info,
-    bfd_boolean little)
+static struct arm_private_data *
+arm_private_data_for(struct disassemble_info *info)
 {
-    unsigned char b[4];
-    unsigned long given;
-    int           status;
-    int           is_thumb = FALSE;
-    int           is_data = FALSE;
-    int           little_code;
-    unsigned int  size = 4;
-    void	 	(*printer) (bfd_vma, struct disassemble_info *, long);
-    bfd_boolean   found = FALSE;
-    struct arm_private_data *private_data;
-
-    /* Clear instruction information field.  */
-    info->insn_info_valid = 0;
-    info->branch_delay_insns = 0;
-    info->data_size = 0;
-    info->insn_type = dis_noninsn;
-    info->target = 0;
-    info->target2 = 0;
-
-    if (info->disassembler_options) {
-        parse_arm_disassembler_options (info->disassembler_options);
-
-        /* To avoid repeated parsing of these options, we remove them here.  */
-        info->disassembler_options = NULL;
-    }
-
     /* PR 10288: Control which instructions will be disassembled.  */
     if (info->private_data == NULL) {
-        static struct arm_private_data private;
+        /* Released by disassemble_free_target.  */
+        struct arm_private_data *private = calloc (1, sizeof (*private));
+        if (private == NULL)
+            abort ();
 
         if ((info->flags & USER_SPECIFIED_MACHINE_TYPE) == 0)
             /* If the user did not use the -m command line switch then default to
@@ -11162,16 +11509,155 @@ print_insn (
         /* Compute the architecture bitmask from the machine number.
         Note: This assumes that the machine number will not change
         during disassembly....  */
-        select_arm_features (info->mach, & private.features);
+        select_arm_features (info->mach, private);
+
+        /* The shared opcode dispatch is built with the first decoder
+           state, rather than inside the first instruction decoded.  */
+        pthread_once (&arm_dispatch_once, arm_dispatch_init);
 
-        private.last_mapping_sym = -1;
-        private.last_mapping_addr = 0;
-        private.last_stop_offset = 0;
+        private->last_mapping_sym = -1;
+        private->last_mapping_addr = 0;
+        private->last_stop_offset = 0;
+        private->regname_selected = ARM_DEFAULT_REGNAMES;
+        mark_outside_vpt_block (&private->vpt_block_state);
 
-        info->private_data = & private;
+        info->private_data = private;
     }
 
-    private_data = info->private_data;
+    return info->private_data;
+}
+
+
+/* Tell the disassembler that the instruction at PC is not inside an IT
+   block, as at a mapping symbol or the start of a function.  Decoding on
+   from PC in order then never scans backwards: the IT state is carried
+   from each Thumb instruction to the next, and find_ifthen_state is only
+   used when decoding resumes somewhere else.  */
+
+void
+arm_reset_ifthen_state(
+    struct disassemble_info *info,
+    bfd_vma pc)
+{
+    struct arm_private_data *private_data = arm_private_data_for (info);
+
+    private_data->ifthen_address = pc;
+    private_data->ifthen_state = 0;
+    private_data->ifthen_next_state = 0;
+}
+
+
+/* Nonzero while the next instruction is inside an IT or VPT block, where
+   how it decodes depends on the instructions before it.  */
+
+int
+arm_in_predicated_block(struct disassemble_info *info)
+{
+    struct arm_private_data *private_data = arm_private_data_for (info);
+
+    return private_data->ifthen_state != 0
+        || private_data->vpt_block_state.in_vpt_block;
+}
+
+
+/* Have mapping symbols looked up through FUNC when INFO has no symbol
+   table, instead of guessing the mode; a NULL FUNC stops the lookups.
+   Call again whenever the index or the buffer changes.  */
+
+void
+arm_set_mapping_func(
+    struct disassemble_info *info,
+    arm_mapping_ftype func)
+{
+    struct arm_private_data *private_data = arm_private_data_for (info);
+
+    private_data->mapping_func = func;
+    private_data->mapping_start = 0;
+    private_data->mapping_end = 0;
+    private_data->mapping_type = 0;
+}
+
+/* Choose the opcode lookups from ARM_DISPATCH_* bits; a clear bit falls
+   back to scanning the opcode table from the top.  For comparing the two
+   in benchmarks: the choice is process-wide, so set it before decoding.  */
+
+void
+arm_set_dispatch(
+    int enabled)
+{
+    arm_dispatch_enabled = enabled;
+}
+
+
+/* The assembler template of the opcode table entry ID names, as set in
+   insn_opcode, or NULL if ID names no entry.  The mnemonic is the text
+   before the first '%' or tab.  */
+
+const char *
+arm_opcode_assembler(
+    unsigned int id)
+{
+    unsigned int entry = id & 0xffff;
+
+#define ARM_TABLE_ENTRY(table) \
+    (entry < ARRAY_SIZE (table) ? table[entry].assembler : NULL)
+
+    switch (id >> 16)
+      {
+      case ARM_TABLE_ARM:		return ARM_TABLE_ENTRY (arm_opcodes);
+      case ARM_TABLE_THUMB16:		return ARM_TABLE_ENTRY (thumb_opcodes);
+      case ARM_TABLE_THUMB32:		return ARM_TABLE_ENTRY (thumb32_opcodes);
+      case ARM_TABLE_COPROC:		return ARM_TABLE_ENTRY (coprocessor_opcodes);
+      case ARM_TABLE_GENERIC_COPROC:	return ARM_TABLE_ENTRY (generic_coprocessor_opcodes);
+      case ARM_TABLE_NEON:		return ARM_TABLE_ENTRY (neon_opcodes);
+      case ARM_TABLE_MVE:		return ARM_TABLE_ENTRY (mve_opcodes);
+      case ARM_TABLE_CDE:		return ARM_TABLE_ENTRY (cde_opcodes);
+      default:				return NULL;
+      }
+
+#undef ARM_TABLE_ENTRY
+}
+
+
+/* NOTE: There are no checks in these routines that
+   the relevant number of data bytes exist.  */
+
+static int
+print_insn (
+    bfd_vma pc,
+    struct disassemble_info* info,
+    bfd_boolean little)
+{
+    unsigned char b[4];
+    unsigned long given;
+    int           status;
+    int           is_thumb = FALSE;
+    int           is_data = FALSE;
+    int           little_code;
+    unsigned int  size = 4;
+    void	 	(*printer) (bfd_vma, struct disassemble_info *, long);
+    bfd_boolean   found = FALSE;
+    struct arm_private_data *private_data;
+
+    /* Clear instruction information field.  */
+    info->insn_info_valid = 0;
+    info->branch_delay_insns = 0;
+    info->data_size = 0;
+    info->insn_type = dis_noninsn;
+    info->target = 0;
+    info->target2 = 0;
+    info->insn_opcode = 0;
+    info->insn_cond = 0xe;
+    info->insn_set_flags = 0;
+
+    private_data = arm_private_data_for (info);
+
+    if (info->disassembler_options) {
+        parse_arm_disassembler_options (private_data, info->disassembler_options);
+
+        /* To avoid repeated parsing of these options, we remove them here.  */
+        info->disassembler_options = NULL;
+    }
 
     /* Decide if our code is going to be little-endian, despite what the
         function argument might say.  */
@@ -11179,8 +11665,9 @@ print_insn (
 
     /* For ELF, consult the symbol table to determine what kind of code
         or data we have.  */
-    if (info->symtab_size != 0
-        && bfd_asymbol_flavour (*info->symtab) == bfd_target_elf_flavour) {
+    if ((info->symtab_size != 0
+        && bfd_asymbol_flavour (*info->symtab) == bfd_target_elf_flavour)
+        || private_data->mapping_func != NULL) {
         bfd_vma addr;
         int n;
         int last_sym = -1;
@@ -11207,6 +11694,9 @@ print_insn (
 		            break;
 		        }
 	        }
+            if (info->symtab_size == 0 && private_data->mapping_func != NULL
+                && private_data->mapping_end - pc < size)
+                size = private_data->mapping_end - pc;
             /* If the next symbol is after three bytes, we need to
                 print only part of the data, so that we can use either
                 .byte or .short.  */
@@ -11247,7 +11737,7 @@ print_insn (
 	    }
     }
 
-    if (force_thumb)
+    if (private_data->force_thumb)
         is_thumb = TRUE;
 
     if (is_data)
@@ -11265,7 +11755,7 @@ print_insn (
         info->bytes_per_chunk = size;
         printer = print_insn_data;
 
-        status = info->read_memory_func (pc, (bfd_byte *) b, size, info);
+        status = arm_read_memory (pc, (bfd_byte *) b, size, info);
         given = 0;
         if (little)
 	        for (i = size - 1; i >= 0; i--)
@@ -11281,7 +11771,7 @@ print_insn (
         info->bytes_per_chunk = 4;
         size = 4;
 
-        status = info->read_memory_func (pc, (bfd_byte *) b, 4, info);
+        status = arm_read_memory (pc, (bfd_byte *) b, 4, info);
         if (little_code)
 	        given = (b[0]) | (b[1] << 8) | (b[2] << 16) | ((unsigned) b[3] << 24);
         else
@@ -11296,7 +11786,7 @@ print_insn (
         info->bytes_per_chunk = 2;
         size = 2;
 
-        status = info->read_memory_func (pc, (bfd_byte *) b, 2, info);
+        status = arm_read_memory (pc, (bfd_byte *) b, 2, info);
         if (little_code)
 	        given = (b[0]) | (b[1] << 8);
         else
@@ -11308,7 +11798,7 @@ print_insn (
             if ((given & 0xF800) == 0xF800
 	            || (given & 0xF800) == 0xF000
 	            || (given & 0xF800) == 0xE800) {
-                status = info->read_memory_func (pc + 2, (bfd_byte *) b, 2, info);
+                status = arm_read_memory (pc + 2, (bfd_byte *) b, 2, info);
                 if (little_code)
 		            given = (b[0]) | (b[1] << 8) | (given << 16);
 	            else
@@ -11319,15 +11809,16 @@ print_insn (
 	        }
 	    }
 
-        if (ifthen_address != pc)
+        if (private_data->ifthen_address != pc)
 	        find_ifthen_state (pc, info, little_code);
 
-        if (ifthen_state) {
-	        if ((ifthen_state & 0xf) == 0x8)
-	            ifthen_next_state = 0;
+        if (private_data->ifthen_state) {
+	        info->insn_cond = IFTHEN_COND;
+	        if ((private_data->ifthen_state & 0xf) == 0x8)
+	            private_data->ifthen_next_state = 0;
 	        else
-	            ifthen_next_state = (ifthen_state & 0xe0)
-    				| ((ifthen_state & 0xf) << 1);
+	            private_data->ifthen_next_state = (private_data->ifthen_state & 0xe0)
+    				| ((private_data->ifthen_state & 0xf) << 1);
 	    }
     }
 
@@ -11346,8 +11837,8 @@ print_insn (
     printer (pc, info, given);
 
     if (is_thumb) {
-        ifthen_state = ifthen_next_state;
-        ifthen_address += size;
+        private_data->ifthen_state = private_data->ifthen_next_state;
+        private_data->ifthen_address += size;
     }
     return size;
 }
@@ -203,6 +203,12 @@ typedef struct disassemble_info {
     bfd_vma target;		/* Target address of branch or dref, if known;
                     zero if unknown.  */
     bfd_vma target2;		/* Second target address for dref2 */
+    unsigned int insn_opcode;	/* Opcode table entry that matched, as an
+                    opaque non-zero id; zero if unknown.  */
+    unsigned char insn_cond;	/* Condition code the insn executes under
+                    (0x0-0xd), 0xe if it always executes.  */
+    unsigned char insn_set_flags;	/* Non-zero if the mnemonic carries an S
+                    suffix, so the insn sets the condition flags.  */
 
     /* Command line options specific to the target disassembler.  */
     const char *disassembler_options;
@@ -298,6 +304,24 @@ typedef int (*disassembler_ftype) (bfd_vma, disassemble_info *);
 // extern void print_wasm32_disassembler_options (FILE *);
 // extern bfd_boolean aarch64_symbol_is_valid (asymbol *, struct disassemble_info *);
 extern bfd_boolean arm_symbol_is_valid (asymbol *, struct disassemble_info *);
+extern void arm_reset_ifthen_state (struct disassemble_info *, bfd_vma);
+extern int arm_in_predicated_block (struct disassemble_info *);
+/* Finds the mapping symbol run holding PC in a caller's sorted index of
+   $a/$t/$d symbols: returns 'a', 't' or 'd' (0 before the first symbol)
+   and sets [*START, *END) to the addresses the run covers.  */
+typedef int (*arm_mapping_ftype) (bfd_vma, bfd_vma *, bfd_vma *,
+                                  struct disassemble_info *);
+extern void arm_set_mapping_func (struct disassemble_info *, arm_mapping_ftype);
+/* Opcode lookups arm_set_dispatch can turn off, falling back to a linear
+   scan of the opcode tables; all are on by default.  */
+#define ARM_DISPATCH_TABLES  0x1 /* bucketed ARM, Thumb-32, coprocessor,
+                                    NEON and MVE tables */
+#define ARM_DISPATCH_THUMB16 0x2 /* the 64K-entry 16-bit Thumb table */
+#define ARM_DISPATCH_ALL     (ARM_DISPATCH_TABLES | ARM_DISPATCH_THUMB16)
+extern void arm_set_dispatch (int);
+/* The assembler template of the opcode table entry an insn_opcode id
+   names, or NULL.  */
+extern const char *arm_opcode_assembler (unsigned int);
 // extern bfd_boolean csky_symbol_is_valid (asymbol *, struct disassemble_info *);
 // extern bfd_boolean riscv_symbol_is_valid (asymbol *, struct disassemble_info *);
 // extern void disassemble_init_powerpc (struct disassemble_info *);
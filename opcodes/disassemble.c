@@ -731,6 +731,10 @@ disassemble_free_target(struct disassemble_info *info)
         case bfd_arch_arc:
             break;
         #endif
+        #ifdef ARCH_arm
+        case bfd_arch_arm:
+            break;
+        #endif
         #ifdef ARCH_cris
         case bfd_arch_cris:
             break;